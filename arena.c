@@ -0,0 +1,100 @@
+// Arena (region) allocation
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utilities.h"
+#include "arena.h"
+
+// Alignment of storage returned by arena_alloc
+#define ARENA_ALIGN (_Alignof(max_align_t))
+
+// Chunks of storage, linked from the most recently allocated one
+typedef struct arena_chunk_s {
+    struct arena_chunk_s *prev;
+    size_t size; // number of bytes in data
+    _Alignas(max_align_t) char data[];
+} arena_chunk;
+
+struct arena_s {
+    arena_chunk *chunks; // the current chunk (or NULL)
+    char *next;          // next free byte in the current chunk
+    char *limit;         // end of the current chunk
+    size_t chunk_size;
+};
+
+// Return a fresh, empty arena whose chunks hold (at least)
+// chunk_size bytes.
+arena *arena_create(size_t chunk_size)
+{
+    arena *ret = (arena *) malloc(sizeof(arena));
+    if (ret == NULL) {
+	bail_with_error("No space to allocate arena!");
+    }
+    ret->chunks = NULL;
+    ret->next = NULL;
+    ret->limit = NULL;
+    ret->chunk_size = chunk_size;
+    return ret;
+}
+
+// Add a new chunk to a that holds at least size bytes,
+// making it the current chunk
+static void arena_grow(arena *a, size_t size)
+{
+    size_t sz = (size > a->chunk_size) ? size : a->chunk_size;
+    arena_chunk *c = (arena_chunk *) malloc(sizeof(arena_chunk) + sz);
+    if (c == NULL) {
+	bail_with_error("No space to grow arena!");
+    }
+    c->prev = a->chunks;
+    c->size = sz;
+    a->chunks = c;
+    a->next = c->data;
+    a->limit = c->data + sz;
+}
+
+// Return a pointer to size bytes of uninitialized storage in a,
+// suitably aligned for any type.
+void *arena_alloc(arena *a, size_t size)
+{
+    uintptr_t p = ((uintptr_t) a->next + ARENA_ALIGN - 1)
+	& ~(uintptr_t) (ARENA_ALIGN - 1);
+    if (a->next == NULL || p + size > (uintptr_t) a->limit) {
+	arena_grow(a, size);
+	p = (uintptr_t) a->next;
+    }
+    a->next = (char *) (p + size);
+    return (void *) p;
+}
+
+// Return a null-terminated copy of the first len chars of s,
+// allocated (without any alignment padding) in a.
+char *arena_strndup(arena *a, const char *s, size_t len)
+{
+    if (a->next == NULL || (size_t) (a->limit - a->next) < len + 1) {
+	arena_grow(a, len + 1);
+    }
+    char *ret = a->next;
+    memcpy(ret, s, len);
+    ret[len] = '\0';
+    a->next += len + 1;
+    return ret;
+}
+
+// Give back all the storage allocated in a at once,
+// keeping the current chunk for reuse.
+void arena_release(arena *a)
+{
+    if (a->chunks == NULL) {
+	return;
+    }
+    arena_chunk *c = a->chunks->prev;
+    while (c != NULL) {
+	arena_chunk *prev = c->prev;
+	free(c);
+	c = prev;
+    }
+    a->chunks->prev = NULL;
+    a->next = a->chunks->data;
+    a->limit = a->chunks->data + a->chunks->size;
+}
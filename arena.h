@@ -0,0 +1,34 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+#include <stddef.h>
+
+// An arena (region) allocator: memory is handed out from large chunks
+// by bumping a pointer, and is only given back all at once.
+typedef struct arena_s arena;
+
+// Return a fresh, empty arena whose chunks hold (at least)
+// chunk_size bytes.
+// If there is no space, bail with an error message,
+// so this never returns NULL.
+extern arena *arena_create(size_t chunk_size);
+
+// Requires: a != NULL
+// Return a pointer to size bytes of uninitialized storage in a,
+// suitably aligned for any type.
+// The storage lives until the arena is released.
+// If there is no space, bail with an error message,
+// so this never returns NULL.
+extern void *arena_alloc(arena *a, size_t size);
+
+// Requires: a != NULL and s has at least len chars
+// Return a null-terminated copy of the first len chars of s,
+// allocated (without any alignment padding) in a.
+extern char *arena_strndup(arena *a, const char *s, size_t len);
+
+// Requires: a != NULL
+// Give back all the storage allocated in a at once,
+// making all pointers into it invalid.
+// The arena stays usable (and keeps one chunk for reuse).
+extern void arena_release(arena *a);
+
+#endif
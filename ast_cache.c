@@ -0,0 +1,426 @@
+// On-disk cache of scope checked ASTs (see ast_cache.h)
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "utilities.h"
+#include "intern.h"
+#include "flat_ast.h"
+#include "ast_cache.h"
+
+// The version of the compiler, which is part of every key.
+// As the compiler is built from all its sources at once,
+// the time of the build changes whenever any of them does.
+#ifndef COMPILER_VERSION
+#define COMPILER_VERSION __DATE__ " " __TIME__
+#endif
+
+// The magic number and version of the format of the cache's files
+#define AST_CACHE_MAGIC "PL0A"
+#define AST_CACHE_MAGIC_LEN 4
+#define AST_CACHE_VERSION 1
+
+// The header of a cache file (whose fields need no padding)
+typedef struct {
+    char magic[AST_CACHE_MAGIC_LEN];
+    uint32_t version;
+    ast_cache_key key;
+    uint64_t source_len;
+    uint64_t checksum;		// of everything after the header
+    uint32_t num_nodes;
+    uint32_t num_lists;
+    uint32_t num_names;
+    uint32_t names_bytes;	// including their padding
+} ast_cache_header;
+
+// Multipliers for hashing (odd, with well mixed bits)
+#define HASH_K1 0x9e3779b97f4a7c15ull
+#define HASH_K2 0xc2b2ae3d27d4eb4full
+#define HASH_K3 0x165667b19e3779f9ull
+
+// Return x rotated left by r bits
+static inline uint64_t rotl64(uint64_t x, unsigned int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+// Return x with its bits mixed (the finalizer of MurmurHash3)
+static inline uint64_t fmix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+// Set h to a 128-bit hash (not a cryptographic one) of the len bytes
+// at buf, starting from seed.  The bytes are read 16 at a time
+// into two independent lanes, so hashing is much faster than lexing.
+static void hash_bytes(const char *buf, size_t len, uint64_t seed,
+		       uint64_t h[2])
+{
+    uint64_t a = seed ^ HASH_K1;
+    uint64_t b = seed ^ HASH_K2;
+    uint64_t w1, w2;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+	memcpy(&w1, buf + i, 8);
+	memcpy(&w2, buf + i + 8, 8);
+	a = rotl64(a ^ (w1 * HASH_K2), 31) * HASH_K1;
+	b = rotl64(b ^ (w2 * HASH_K1), 29) * HASH_K3;
+    }
+    // the last (up to 15) bytes, padded with zeros
+    char tail[16] = { 0 };
+    memcpy(tail, buf + i, len - i);
+    memcpy(&w1, tail, 8);
+    memcpy(&w2, tail + 8, 8);
+    a = rotl64(a ^ (w1 * HASH_K2), 31) * HASH_K1;
+    b = rotl64(b ^ (w2 * HASH_K1), 29) * HASH_K3;
+    a ^= (uint64_t) len;
+    b ^= (uint64_t) len;
+    h[0] = fmix64(a + rotl64(b, 17));
+    h[1] = fmix64(b ^ (a * HASH_K3));
+}
+
+// Return the key of the program whose source text is the len bytes at text
+ast_cache_key ast_cache_key_of(const char *text, size_t len)
+{
+    static const char version[] = COMPILER_VERSION;
+    uint64_t seed[2];
+    hash_bytes(version, sizeof(version) - 1, AST_CACHE_VERSION, seed);
+    ast_cache_key ret;
+    hash_bytes(text, len, seed[0] ^ seed[1], ret.hash);
+    return ret;
+}
+
+// Return the checksum of the len bytes at buf
+static uint64_t checksum(const char *buf, size_t len)
+{
+    uint64_t h[2];
+    hash_bytes(buf, len, 0, h);
+    return h[0];
+}
+
+// Return the (malloc-ed) name of the file in dir
+// of the entry for key, or (if tmp) of a template
+// for a temporary file (see mkstemp)
+static char *entry_path(const char *dir, ast_cache_key key, bool tmp)
+{
+    size_t len = strlen(dir) + 48;
+    char *ret = (char *) malloc(len);
+    if (ret == NULL) {
+	bail_with_error("No space for the name of an AST cache entry!");
+    }
+    if (tmp) {
+	snprintf(ret, len, "%s/tmp-XXXXXX", dir);
+    } else {
+	snprintf(ret, len, "%s/%016llx%016llx.ast", dir,
+		 (unsigned long long) key.hash[0],
+		 (unsigned long long) key.hash[1]);
+    }
+    return ret;
+}
+
+// Return the malloc-ed contents of the file named fname,
+// setting *len to its length, or NULL if it cannot be read
+static char *read_entry(const char *fname, size_t *len)
+{
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL) {
+	return NULL;
+    }
+    struct stat st;
+    char *buf = NULL;
+    if (fstat(fileno(f), &st) == 0 && st.st_size >= 0
+	&& (size_t) st.st_size >= sizeof(ast_cache_header)) {
+	*len = (size_t) st.st_size;
+	buf = (char *) malloc(*len);
+	if (buf != NULL && fread(buf, 1, *len, f) != *len) {
+	    free(buf);
+	    buf = NULL;
+	}
+    }
+    fclose(f);
+    return buf;
+}
+
+// Is the flat node index kid a child of (so after) the node i in fa?
+static bool valid_kid(flat_ast *fa, flat_index i, flat_index kid)
+{
+    return i < kid && kid < fa->num_nodes;
+}
+
+// Is fa (read from a cache file) a program that flat_ast_to_ast
+// can convert, whose offsets are all within source_len bytes,
+// and whose names' scope offsets are all within its frame?
+// As children always follow their parents, converting it terminates.
+static bool valid_flat_ast(flat_ast *fa, size_t source_len)
+{
+    if (fa->num_nodes == 0 || fa->nodes[0].type_tag != program_ast) {
+	return false;
+    }
+    // the frame holds a variable for each declaration
+    uint64_t frame_size = (uint64_t) fa->nodes[0].u.kids.a
+	+ fa->nodes[0].u.kids.b;
+    for (uint32_t j = 0; j < fa->num_names; j++) {
+	if (fa->offsets[j] >= frame_size) {
+	    return false;
+	}
+    }
+    for (flat_index i = 0; i < fa->num_nodes; i++) {
+	flat_node *n = &fa->nodes[i];
+	if (n->offset > source_len) {
+	    return false;
+	}
+	switch (n->type_tag) {
+	case program_ast: {
+	    uint64_t ndecls = (uint64_t) n->u.kids.a + n->u.kids.b;
+	    if (i != 0 || ndecls >= fa->num_nodes
+		|| !valid_kid(fa, i + (flat_index) ndecls, n->u.kids.c)) {
+		return false;
+	    }
+	    for (flat_index d = 1; d <= ndecls; d++) {
+		uint8_t want = (d <= n->u.kids.a) ? const_decl_ast : var_decl_ast;
+		if (fa->nodes[d].type_tag != want) {
+		    return false;
+		}
+	    }
+	    break;
+	}
+	case const_decl_ast:
+	case var_decl_ast:
+	case read_ast:
+	case ident_ast:
+	    if (n->u.named.name >= fa->num_names) {
+		return false;
+	    }
+	    break;
+	case assign_ast:
+	    if (n->u.named.name >= fa->num_names
+		|| !valid_kid(fa, i, n->u.named.kid)) {
+		return false;
+	    }
+	    break;
+	case begin_ast:
+	    if ((uint64_t) n->u.range.start + n->u.range.count > fa->num_lists) {
+		return false;
+	    }
+	    for (uint32_t j = 0; j < n->u.range.count; j++) {
+		if (!valid_kid(fa, i, fa->lists[n->u.range.start + j])) {
+		    return false;
+		}
+	    }
+	    break;
+	case if_ast:
+	    if (!valid_kid(fa, i, n->u.kids.c)) {
+		return false;
+	    }
+	    // fall through
+	case while_ast:
+	    if (!valid_kid(fa, i, n->u.kids.b)) {
+		return false;
+	    }
+	    // fall through
+	case write_ast:
+	case odd_cond_ast:
+	    if (!valid_kid(fa, i, n->u.kids.a)) {
+		return false;
+	    }
+	    break;
+	case bin_cond_ast:
+	    if (n->op > geqop || !valid_kid(fa, i, n->u.kids.a)
+		|| !valid_kid(fa, i, n->u.kids.b)) {
+		return false;
+	    }
+	    break;
+	case op_expr_ast:
+	    if (n->op > divop || !valid_kid(fa, i, n->u.kids.a)) {
+		return false;
+	    }
+	    break;
+	case bin_expr_ast:
+	    if (n->op > divop || !valid_kid(fa, i, n->u.kids.a)
+		|| !valid_kid(fa, i, n->u.kids.b)) {
+		return false;
+	    }
+	    break;
+	case skip_ast:
+	case number_ast:
+	    break;
+	default:
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Return a (pointer to a) fresh program AST for the len bytes at buf
+// (the contents of a cache file), or NULL if they are not a valid entry
+// for key.  The names in it are interned,
+// and all its file locations are in the file with id file.
+static AST *entry_to_ast(char *buf, size_t len, ast_cache_key key,
+			 size_t source_len, unsigned int file)
+{
+    ast_cache_header hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+    uint64_t payload_len = (uint64_t) hdr.names_bytes
+	+ sizeof(uint32_t) * ((uint64_t) hdr.num_names + hdr.num_lists)
+	+ sizeof(flat_node) * (uint64_t) hdr.num_nodes;
+    if (memcmp(hdr.magic, AST_CACHE_MAGIC, AST_CACHE_MAGIC_LEN) != 0
+	|| hdr.version != AST_CACHE_VERSION
+	|| memcmp(&hdr.key, &key, sizeof(key)) != 0
+	|| hdr.source_len != source_len
+	|| hdr.names_bytes % 4 != 0
+	|| payload_len != len - sizeof(hdr)
+	|| hdr.checksum != checksum(buf + sizeof(hdr), len - sizeof(hdr))) {
+	return NULL;
+    }
+
+    flat_ast fa;
+    char *p = buf + sizeof(hdr);
+    const char *names_end = p + hdr.names_bytes;
+    fa.num_names = hdr.num_names;
+    fa.names = (const char **) malloc((hdr.num_names + 1) * sizeof(const char *));
+    if (fa.names == NULL) {
+	bail_with_error("No space for the names of an AST cache entry!");
+    }
+    for (uint32_t i = 0; i < hdr.num_names; i++) {
+	const char *end = memchr(p, '\0', names_end - p);
+	if (end == NULL) {
+	    free(fa.names);
+	    return NULL;
+	}
+	fa.names[i] = intern_string(p, end - p);
+	p = (char *) end + 1;
+    }
+    // the offsets, lists, and nodes are 4-byte aligned in buf
+    // (as malloc's result is, and the header and names are a multiple of 4)
+    fa.offsets = (uint32_t *) names_end;
+    fa.lists = (flat_index *) (fa.offsets + hdr.num_names);
+    fa.num_lists = hdr.num_lists;
+    fa.nodes = (flat_node *) (fa.lists + hdr.num_lists);
+    fa.num_nodes = hdr.num_nodes;
+    AST *ret = NULL;
+    if (valid_flat_ast(&fa, source_len)) {
+	for (flat_index i = 0; i < fa.num_nodes; i++) {
+	    fa.nodes[i].file = (uint16_t) file;
+	}
+	ret = flat_ast_to_ast(&fa);
+    }
+    free(fa.names);
+    return ret;
+}
+
+// Return a (pointer to a) fresh program AST equivalent to the one
+// cached in the directory dir under key, or NULL if there is none
+AST *ast_cache_load(const char *dir, ast_cache_key key,
+		    size_t source_len, unsigned int file)
+{
+    if (file > UINT16_MAX) {
+	return NULL;
+    }
+    char *fname = entry_path(dir, key, false);
+    size_t len;
+    // a missing entry is no error (for later error messages)
+    int saved_errno = errno;
+    char *buf = read_entry(fname, &len);
+    errno = saved_errno;
+    free(fname);
+    if (buf == NULL) {
+	return NULL;
+    }
+    AST *ret = entry_to_ast(buf, len, key, source_len, file);
+    free(buf);
+    return ret;
+}
+
+// Return the malloc-ed contents of a cache file for key holding fa,
+// setting *len to its length
+static char *flat_ast_to_entry(flat_ast *fa, ast_cache_key key,
+			       size_t source_len, size_t *len)
+{
+    ast_cache_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, AST_CACHE_MAGIC, AST_CACHE_MAGIC_LEN);
+    hdr.version = AST_CACHE_VERSION;
+    hdr.key = key;
+    hdr.source_len = source_len;
+    hdr.num_nodes = fa->num_nodes;
+    hdr.num_lists = fa->num_lists;
+    hdr.num_names = fa->num_names;
+    size_t names_bytes = 0;
+    for (uint32_t i = 0; i < fa->num_names; i++) {
+	names_bytes += strlen(fa->names[i]) + 1;
+    }
+    names_bytes = (names_bytes + 3) & ~(size_t) 3;
+    if (names_bytes > UINT32_MAX) {
+	bail_with_error("Too many names for an AST cache entry!");
+    }
+    hdr.names_bytes = (uint32_t) names_bytes;
+    *len = sizeof(hdr) + names_bytes
+	+ sizeof(uint32_t) * ((size_t) fa->num_names + fa->num_lists)
+	+ sizeof(flat_node) * (size_t) fa->num_nodes;
+
+    char *buf = (char *) calloc(1, *len);
+    if (buf == NULL) {
+	bail_with_error("No space for an AST cache entry!");
+    }
+    char *p = buf + sizeof(hdr);
+    for (uint32_t i = 0; i < fa->num_names; i++) {
+	size_t n = strlen(fa->names[i]) + 1;
+	memcpy(p, fa->names[i], n);
+	p += n;
+    }
+    p = buf + sizeof(hdr) + names_bytes;
+    memcpy(p, fa->offsets, sizeof(uint32_t) * fa->num_names);
+    p += sizeof(uint32_t) * fa->num_names;
+    memcpy(p, fa->lists, sizeof(flat_index) * fa->num_lists);
+    p += sizeof(flat_index) * fa->num_lists;
+    memcpy(p, fa->nodes, sizeof(flat_node) * fa->num_nodes);
+    hdr.checksum = checksum(buf + sizeof(hdr), *len - sizeof(hdr));
+    memcpy(buf, &hdr, sizeof(hdr));
+    return buf;
+}
+
+// Store (the flat form of) prog in the directory dir under key
+void ast_cache_store(const char *dir, ast_cache_key key,
+		     size_t source_len, AST *prog)
+{
+    int saved_errno = errno;
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+	bail_with_error("Cannot create AST cache directory %s", dir);
+    }
+    // an existing directory is no error (for later error messages)
+    errno = saved_errno;
+    flat_ast *fa = flat_ast_from_ast(prog);
+    size_t len;
+    char *buf = flat_ast_to_entry(fa, key, source_len, &len);
+    flat_ast_free(fa);
+
+    char *tmpname = entry_path(dir, key, true);
+    char *fname = entry_path(dir, key, false);
+    int fd = mkstemp(tmpname);
+    FILE *f = (fd < 0) ? NULL : fdopen(fd, "wb");
+    bool written = f != NULL && fwrite(buf, 1, len, f) == len;
+    if (f != NULL) {
+	written = (fclose(f) == 0) && written;
+    } else if (fd >= 0) {
+	close(fd);
+    }
+    free(buf);
+    if (!written || rename(tmpname, fname) != 0) {
+	if (fd >= 0) {
+	    unlink(tmpname);
+	}
+	free(tmpname);
+	free(fname);
+	bail_with_error("Cannot write an AST cache entry in %s", dir);
+    }
+    free(tmpname);
+    free(fname);
+}
@@ -0,0 +1,52 @@
+#ifndef _AST_CACHE_H
+#define _AST_CACHE_H
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+
+// An on-disk cache of scope checked program ASTs, so that compiling
+// an unchanged file again can skip lexing, parsing, and scope checking.
+// The cache is a directory holding one file per program, named by
+// the program's key (in hex, with the suffix .ast): a hash of
+// the program's source text and the version of the compiler
+// (so a rebuilt compiler never uses the ASTs cached by another build).
+// Each file holds the flat form of the AST (see flat_ast.h), as
+//   a header: the magic "PL0A", the format's version, the key,
+//             the length of the source text, a checksum of the rest,
+//             and the numbers of nodes, list elements, and names,
+//             and the number of bytes of names,
+//   the names (each null-terminated, padded to a multiple of 4 bytes),
+//   the names' offsets (as set by the scope checker),
+//   the list elements of the begin statements, and
+//   the nodes,
+// all in the byte order of the machine that wrote it.
+// Entries are written to a temporary file that is then renamed,
+// so units compiled at the same time (even by several processes)
+// never see a partly written entry.
+
+// The key of a program in the cache
+typedef struct {
+    uint64_t hash[2];
+} ast_cache_key;
+
+// Return the key of the program whose source text is the len bytes at text
+extern ast_cache_key ast_cache_key_of(const char *text, size_t len);
+
+// Requires: dir != NULL
+// Return a (pointer to a) fresh program AST equivalent to the one
+// cached in the directory dir under key (for a source text
+// of source_len bytes), whose file locations are in the file with id file
+// (see file_location.h), or NULL if there is no such entry.
+// Entries that cannot be read, or that are not valid, are ignored.
+extern AST *ast_cache_load(const char *dir, ast_cache_key key,
+			   size_t source_len, unsigned int file);
+
+// Requires: dir != NULL and prog has been scope checked
+// Store (the flat form of) prog in the directory dir
+// (which is created if need be) under key,
+// for a source text of source_len bytes.
+// If that cannot be done, bail with an error message.
+extern void ast_cache_store(const char *dir, ast_cache_key key,
+			    size_t source_len, AST *prog);
+
+#endif
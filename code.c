@@ -0,0 +1,165 @@
+// Bytecode programs and their file format
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utilities.h"
+#include "code.h"
+
+// The file format is a header of 4 words (magic, version,
+// frame size, and number of instructions) followed by the
+// instructions, where all words are 32 bits, little-endian.
+#define CODE_MAGIC 0x42304C50 // "PL0B"
+#define CODE_VERSION 1
+
+// Initial room for instructions in a code_seq
+#define CODE_INITIAL_CAPACITY 256
+
+// Does op_code op take an argument?
+bool op_has_arg(op_code op)
+{
+    return op == op_lit || op == op_lod || op == op_sto
+	|| op == op_jmp || op == op_jpc;
+}
+
+// Return the (assembly language) name of op_code op
+const char *op2str(op_code op)
+{
+    static const char *op_names[NUM_OP_CODES] =
+	{"LIT", "LOD", "STO",
+	 "ADD", "SUB", "MUL", "DIV",
+	 "EQL", "NEQ", "LSS", "LEQ", "GTR", "GEQ",
+	 "ODD", "JMP", "JPC", "RCH", "WCH", "HLT"};
+    return op_names[op];
+}
+
+// Return a fresh, empty code_seq with frame_size variables.
+code_seq *code_seq_create(uint32_t frame_size)
+{
+    code_seq *ret = (code_seq *) malloc(sizeof(code_seq));
+    if (ret == NULL) {
+	bail_with_error("No space for code!");
+    }
+    ret->frame_size = frame_size;
+    ret->count = 0;
+    ret->capacity = CODE_INITIAL_CAPACITY;
+    ret->instrs = (instr *) malloc(ret->capacity * sizeof(instr));
+    if (ret->instrs == NULL) {
+	bail_with_error("No space for code!");
+    }
+    return ret;
+}
+
+// Make sure there is room for one more instruction in cs
+static void code_ensure_room(code_seq *cs)
+{
+    if (cs->count == cs->capacity) {
+	cs->capacity *= 2;
+	cs->instrs = (instr *) realloc(cs->instrs, cs->capacity * sizeof(instr));
+	if (cs->instrs == NULL) {
+	    bail_with_error("No space for code!");
+	}
+    }
+}
+
+// Append the instruction with op_code op and argument arg to cs,
+// returning its index
+uint32_t code_emit(code_seq *cs, op_code op, int32_t arg)
+{
+    if (arg < INSTR_ARG_MIN || INSTR_ARG_MAX < arg) {
+	bail_with_error("Argument %d of %s is too large for an instruction!",
+			arg, op2str(op));
+    }
+    code_ensure_room(cs);
+    cs->instrs[cs->count] = instr_make(op, arg);
+    return cs->count++;
+}
+
+// Change the argument of the instruction at index at in cs to arg
+void code_patch(code_seq *cs, uint32_t at, int32_t arg)
+{
+    if (arg < INSTR_ARG_MIN || INSTR_ARG_MAX < arg) {
+	bail_with_error("Jump target %d is too large for an instruction!",
+			arg);
+    }
+    cs->instrs[at] = instr_make(instr_op(cs->instrs[at]), arg);
+}
+
+// Give back the storage of cs
+void code_seq_free(code_seq *cs)
+{
+    free(cs->instrs);
+    free(cs);
+}
+
+// Store w into buf (4 bytes) in little-endian order
+static void code_put_word(unsigned char *buf, uint32_t w)
+{
+    buf[0] = w & 0xFF;
+    buf[1] = (w >> 8) & 0xFF;
+    buf[2] = (w >> 16) & 0xFF;
+    buf[3] = (w >> 24) & 0xFF;
+}
+
+// Return the little-endian word in buf (4 bytes)
+static uint32_t code_get_word(const unsigned char *buf)
+{
+    return (uint32_t) buf[0] | ((uint32_t) buf[1] << 8)
+	| ((uint32_t) buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
+
+// Write cs to the named file in the bytecode file format
+void code_write_file(code_seq *cs, const char *fname)
+{
+    FILE *f = fopen(fname, "wb");
+    if (f == NULL) {
+	bail_with_error("Cannot open %s", fname);
+    }
+    unsigned char buf[BUFSIZ];
+    code_put_word(buf, CODE_MAGIC);
+    code_put_word(buf + 4, CODE_VERSION);
+    code_put_word(buf + 8, cs->frame_size);
+    code_put_word(buf + 12, cs->count);
+    size_t n = 16;
+    for (uint32_t i = 0; i < cs->count; i++) {
+	if (n + 4 > sizeof(buf)) {
+	    fwrite(buf, 1, n, f);
+	    n = 0;
+	}
+	code_put_word(buf + n, cs->instrs[i]);
+	n += 4;
+    }
+    fwrite(buf, 1, n, f);
+    if (ferror(f) || fclose(f) == EOF) {
+	bail_with_error("Cannot write %s", fname);
+    }
+}
+
+// Return the program read from the named bytecode file
+code_seq *code_read_file(const char *fname)
+{
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL) {
+	bail_with_error("Cannot open %s", fname);
+    }
+    unsigned char hdr[16];
+    if (fread(hdr, 1, sizeof(hdr), f) != sizeof(hdr)
+	|| code_get_word(hdr) != CODE_MAGIC) {
+	bail_with_error("%s is not a PL/0 bytecode file!", fname);
+    }
+    if (code_get_word(hdr + 4) != CODE_VERSION) {
+	bail_with_error("%s has an unsupported bytecode version (%u)!",
+			fname, code_get_word(hdr + 4));
+    }
+    code_seq *cs = code_seq_create(code_get_word(hdr + 8));
+    uint32_t count = code_get_word(hdr + 12);
+    unsigned char w[4];
+    for (uint32_t i = 0; i < count; i++) {
+	if (fread(w, 1, 4, f) != 4) {
+	    bail_with_error("%s is truncated!", fname);
+	}
+	code_ensure_room(cs);
+	cs->instrs[cs->count++] = code_get_word(w);
+    }
+    fclose(f);
+    return cs;
+}
@@ -0,0 +1,96 @@
+#ifndef _CODE_H
+#define _CODE_H
+#include <stdint.h>
+#include <stdbool.h>
+
+// The bytecode for the PL/0 stack machine (see vm.c).
+// Values are shorts; the machine has a frame of variables
+// (indexed by the offsets assigned by the scope checker)
+// and an expression stack.
+// Each instruction is one 32-bit word: the low 8 bits are
+// the op_code and the high 24 bits are a signed argument
+// (used only by the instructions marked with "n" below).
+
+// the instructions
+typedef enum {
+    op_lit,  // n: push n
+    op_lod,  // n: push frame[n]
+    op_sto,  // n: pop into frame[n]
+    op_add, op_sub, op_mul, op_div, // pop b, pop a, push a o b
+    op_eql, op_neq, op_lss, op_leq, op_gtr, op_geq, // pop b, pop a,
+				    // push 1 if a r b, 0 otherwise
+    op_odd,  // pop a, push 1 if a is odd, 0 otherwise
+    op_jmp,  // n: continue at instruction n
+    op_jpc,  // n: pop a, continue at instruction n if a == 0
+    op_rch,  // push a character read from stdin (-1 on EOF)
+    op_wch,  // pop a, write it to stdout as a character
+    op_hlt   // stop the machine
+} op_code;
+
+#define NUM_OP_CODES (op_hlt + 1)
+
+// An instruction
+typedef uint32_t instr;
+
+// Largest and smallest arguments an instruction can hold
+#define INSTR_ARG_MAX ((1 << 23) - 1)
+#define INSTR_ARG_MIN (-(1 << 23))
+
+// Return the instruction with op_code op and argument arg
+static inline instr instr_make(op_code op, int32_t arg)
+{
+    return (uint32_t) op | ((uint32_t) arg << 8);
+}
+
+// Return the op_code of instruction i
+static inline op_code instr_op(instr i)
+{
+    return (op_code) (i & 0xFF);
+}
+
+// Return the (sign extended) argument of instruction i
+static inline int32_t instr_arg(instr i)
+{
+    int32_t a = (int32_t) (i >> 8);
+    return (a & (1 << 23)) ? a - (1 << 24) : a;
+}
+
+// Does op_code op take an argument?
+extern bool op_has_arg(op_code op);
+
+// Return the (assembly language) name of op_code op
+extern const char *op2str(op_code op);
+
+// A program for the machine
+typedef struct {
+    uint32_t frame_size; // number of variables in the frame
+    uint32_t count;      // number of instructions
+    uint32_t capacity;   // room for instructions
+    instr *instrs;
+} code_seq;
+
+// Return a fresh, empty code_seq with frame_size variables.
+// If there is no space, bail with an error message,
+// so this never returns NULL.
+extern code_seq *code_seq_create(uint32_t frame_size);
+
+// Append the instruction with op_code op and argument arg to cs,
+// returning its index (bailing with an error if arg is out of range)
+extern uint32_t code_emit(code_seq *cs, op_code op, int32_t arg);
+
+// Requires: at < cs->count
+// Change the argument of the instruction at index at in cs to arg
+extern void code_patch(code_seq *cs, uint32_t at, int32_t arg);
+
+// Give back the storage of cs
+extern void code_seq_free(code_seq *cs);
+
+// Write cs to the named file in the bytecode file format
+// (bailing with an error message if that fails)
+extern void code_write_file(code_seq *cs, const char *fname);
+
+// Return the program read from the named bytecode file
+// (bailing with an error message if that fails)
+extern code_seq *code_read_file(const char *fname);
+
+#endif
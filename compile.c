@@ -0,0 +1,200 @@
+// Compilation of a unit (file) in a context, which is reentrant
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <setjmp.h>
+#include "utilities.h"
+#include "lexer.h"
+#include "lexer_output.h"
+#include "tokstream.h"
+#include "ast_cache.h"
+#include "reparse.h"
+#include "parser_api.h"
+#include "scope_check.h"
+#include "scope_symtab.h"
+#include "optimize.h"
+#include "unparser.h"
+#include "gen_code.h"
+#include "gen_asm.h"
+#include "interpret.h"
+#include "compile.h"
+
+// Make the edits in the file named edits_fname ("-" for stdin)
+// to the file named fname, parsing what each changes again,
+// reporting what each parsed again on log (if not NULL),
+// and return the AST of the edited program,
+// or NULL if it does not parse (its errors were reported)
+static AST *parse_edited(const char *fname, const char *edits_fname,
+			 FILE *log)
+{
+    bool from_stdin = strcmp(edits_fname, "-") == 0;
+    FILE *edits = from_stdin ? stdin : fopen(edits_fname, "rb");
+    if (edits == NULL) {
+	bail_with_error("Cannot open %s", edits_fname);
+    }
+    reparse_open(fname);
+    bool parses = reparse_edit_file(edits, edits_fname, log);
+    if (!from_stdin) {
+	fclose(edits);
+    }
+    return parses ? reparse_program() : NULL;
+}
+
+// Do what ctx says with the file named fname,
+// which may stop part way by an error; return false if
+// it stopped because its (edited) text did not parse,
+// without an error of its own (see parse_edited)
+static bool compile_unit(compile_context *ctx, const char *fname)
+{
+    compile_options *opts = &ctx->opts;
+    if (opts->lexer_output) {
+	stats_phase_begin(stats_lex);
+	lexer_open(fname);
+	lexer_output_to(ctx->out);
+	lexer_close();
+	stats_phase_end(stats_lex);
+	return true;
+    }
+    if (opts->tokens_filename != NULL) {
+	stats_phase_begin(stats_lex);
+	lexer_open(fname);
+	FILE *tokens_file = fopen(opts->tokens_filename, "wb");
+	if (tokens_file == NULL) {
+	    bail_with_error("Cannot open %s", opts->tokens_filename);
+	}
+	tokstream_write(tokens_file);
+	fclose(tokens_file);
+	lexer_close();
+	stats_phase_end(stats_lex);
+	return true;
+    }
+
+    // an AST found in the cache has been scope checked already
+    AST *progast = NULL;
+    ast_cache_key key;
+    size_t source_len;
+    const char *source = NULL;
+    if (opts->edits_filename != NULL) {
+	// (the cache is keyed by the text before the edits, so it is not used)
+	stats_phase_begin(stats_parse);
+	progast = parse_edited(fname, opts->edits_filename,
+			       opts->verbose ? ctx->err : NULL);
+	stats_phase_end(stats_parse);
+	if (progast == NULL) {
+	    return false;
+	}
+    } else if (opts->cache_dirname != NULL) {
+	stats_phase_begin(stats_cache);
+	lexer_open(fname);
+	unsigned int file;
+	source = lexer_source(&source_len, &file);
+	if (source != NULL) {
+	    key = ast_cache_key_of(source, source_len);
+	    progast = ast_cache_load(opts->cache_dirname, key, source_len, file);
+	    if (progast != NULL) {
+		unit_stats.cache_hits++;
+	    } else {
+		unit_stats.cache_misses++;
+	    }
+	}
+	lexer_close();
+	stats_phase_end(stats_cache);
+    }
+    bool cached = progast != NULL && opts->edits_filename == NULL;
+
+    if (progast == NULL) {
+	stats_phase_begin(stats_parse);
+	parser_open(fname);
+	progast = parseProgram();
+	parser_close();
+	stats_phase_end(stats_parse);
+    }
+    stats_count_ast(progast);
+    if (opts->code_filename == NULL && opts->asm_filename == NULL && !opts->run) {
+	stats_phase_begin(stats_unparse);
+	unparseProgram(ctx->out, progast);
+	stats_phase_end(stats_unparse);
+    }
+
+    if (!cached) {
+	stats_phase_begin(stats_scope);
+	scope_initialize();
+	scope_check_program(progast);
+	stats_phase_end(stats_scope);
+	if (source != NULL) {
+	    // (before the optimizer changes it)
+	    stats_phase_begin(stats_cache);
+	    ast_cache_store(opts->cache_dirname, key, source_len, progast);
+	    stats_phase_end(stats_cache);
+	}
+    }
+    if (opts->optimize) {
+	stats_phase_begin(stats_optimize);
+	optimize_program(progast, opts->verbose ? ctx->err : NULL);
+	stats_phase_end(stats_optimize);
+    }
+
+    if (opts->code_filename != NULL) {
+	stats_phase_begin(stats_codegen);
+	code_seq *code = gen_code_program(progast);
+	code_write_file(code, opts->code_filename);
+	code_seq_free(code);
+	stats_phase_end(stats_codegen);
+    } else if (opts->asm_filename != NULL) {
+	stats_phase_begin(stats_codegen);
+	FILE *asm_file = fopen(opts->asm_filename, "w");
+	if (asm_file == NULL) {
+	    bail_with_error("Cannot open %s", opts->asm_filename);
+	}
+	gen_asm_program(asm_file, progast);
+	fclose(asm_file);
+	stats_phase_end(stats_codegen);
+    } else if (opts->run) {
+	stats_phase_begin(stats_run);
+	interpret_program(ctx->out, progast);
+	stats_phase_end(stats_run);
+    }
+    return true;
+}
+
+// Compile the file named fname as ctx says, in the calling thread,
+// and return its exit status
+int compile_file(compile_context *ctx, const char *fname)
+{
+    jmp_buf recovery;
+    int status = EXIT_SUCCESS;
+    errno = 0;
+    stats_reset();
+    set_error_stream(ctx->err);
+    if (setjmp(recovery) == 0) {
+	set_error_recovery(&recovery);
+	if (!compile_unit(ctx, fname)) {
+	    status = EXIT_FAILURE;
+	}
+	set_error_recovery(NULL);
+    } else {
+	// the unit stopped part way, so give back what it was using
+	set_error_recovery(NULL);
+	status = EXIT_FAILURE;
+	if (!lexer_done()) {
+	    lexer_close();
+	}
+    }
+    scope_finalize();
+    ast_arena_release();
+    lexer_release();
+    reparse_close();
+    set_error_stream(NULL);
+    fflush(ctx->out);
+    if (ctx->opts.stats != stats_none) {
+	// (the phase an error stopped is not counted)
+	stats_print(ctx->err, fname, ctx->opts.stats);
+    }
+    return status;
+}
+
+// Report on err the exit status of the unit in the file named fname
+void compile_report_status(FILE *err, const char *fname, int status)
+{
+    fprintf(err, "%s: exit status %d\n", fname, status);
+}
@@ -0,0 +1,47 @@
+#ifndef _COMPILE_H
+#define _COMPILE_H
+#include <stdio.h>
+#include <stdbool.h>
+#include "stats.h"
+
+// What to do with each compilation unit (file)
+typedef struct {
+    bool lexer_output;	// only print the unit's tokens
+    bool run;		// run the program (by interpreting its AST)
+    bool optimize;	// optimize the program before running or compiling it
+    bool verbose;	// report the node counts of each optimization pass
+			// (and what each edit parsed again)
+    const char *code_filename;	// if not NULL, write bytecode here
+    const char *asm_filename;	// if not NULL, write x86-64 assembly here
+    const char *tokens_filename;	// if not NULL, only write the unit's
+				// tokens here, as a token stream
+    const char *cache_dirname;	// if not NULL, the directory of the
+				// AST cache (see ast_cache.h)
+    const char *edits_filename;	// if not NULL, compile the unit's file
+				// as edited by the edits in this file
+				// ("-" for stdin), see reparse.h
+    stats_format stats;	// how to report the unit's statistics (if at all)
+} compile_options;
+
+// The context in which units are compiled: the options,
+// and where the units' output and error messages go.
+// All other state of a compilation (the lexer's, the parser's,
+// the scope's, and the ASTs) belongs to the thread doing it,
+// so each thread can compile a unit at the same time as others.
+typedef struct {
+    compile_options opts;
+    FILE *out;
+    FILE *err;
+} compile_context;
+
+// Requires: ctx->out and ctx->err are open for writing
+// Compile the file named fname as ctx says, in the calling thread.
+// Errors are reported on ctx->err, and stop only this unit.
+// Return EXIT_SUCCESS if the unit had no errors, otherwise EXIT_FAILURE.
+extern int compile_file(compile_context *ctx, const char *fname);
+
+// Report on err that the unit in the file named fname
+// finished with the given exit status
+extern void compile_report_status(FILE *err, const char *fname, int status);
+
+#endif
@@ -1,12 +1,288 @@
-/* $Id: file_location.c,v 1.1 2023/02/19 03:07:27 leavens Exp $ */
-#include "file_location.h"
-
-// Return the file location information from a token
-file_location token2file_loc(token t)
-{
-    file_location ret;
-    ret.filename = t.filename;
-    ret.line = t.line;
-    ret.column = t.column;
-    return ret;
-}
+/* $Id: file_location.c,v 1.1 2023/02/19 03:07:27 leavens Exp $ */
+#include <stdlib.h>
+#include <string.h>
+#include "utilities.h"
+#include "file_location.h"
+
+// a source file, with an index of where its lines start,
+// which is only built when a line or column is first asked for
+// (or, for a file without its text, is built by file_location_add_line).
+// The text may be in two pieces (see file_location_set_text).
+// After an edit (see file_location_replace), the index is in two parts:
+// the starts of the lines up to the edit (in line_starts), and
+// those of the lines after it, as distances from the end of the text
+// (in tail_ends, from the last line back), which the edit does not change.
+typedef struct {
+    const char *name;
+    const char *text;
+    size_t split; // the number of chars of the text at text
+    const char *rest; // the rest of the text (if split < len)
+    size_t len;
+    unsigned int *line_starts; // offsets of each line's first char, or NULL
+    unsigned int *line_numbers; // if not NULL, the line of each line_starts
+    unsigned int num_lines; // in all
+    unsigned int num_starts; // in line_starts
+    unsigned int lines_cap; // room in line_starts (and line_numbers)
+    unsigned int *tail_ends; // len minus the start of each later line
+    unsigned int num_tails; // in tail_ends
+    unsigned int tails_cap; // room in tail_ends
+    unsigned int last_line; // index of the line last found (a search hint)
+} source_file;
+
+// the source files recorded by the calling thread, indexed by file id
+static _Thread_local source_file *files = NULL;
+static _Thread_local unsigned int num_files = 0;
+static _Thread_local unsigned int files_cap = 0;
+
+// Return the file location information from a token
+file_location token2file_loc(token t)
+{
+    file_location ret;
+    ret.file = t.file;
+    ret.offset = t.offset;
+    return ret;
+}
+
+// Record (for the calling thread) a source file with the given name
+// and contents, and return its id
+unsigned int file_location_add_file(const char *name,
+				    const char *text, size_t len)
+{
+    if (num_files == files_cap) {
+	unsigned int cap = (files_cap == 0) ? 4 : 2 * files_cap;
+	source_file *fs = (source_file *) realloc(files,
+						  cap * sizeof(source_file));
+	if (fs == NULL) {
+	    bail_with_error("No space to record the file %s!", name);
+	}
+	files = fs;
+	files_cap = cap;
+    }
+    source_file *sf = &files[num_files];
+    sf->name = name;
+    sf->text = text;
+    sf->split = len;
+    sf->rest = NULL;
+    sf->len = len;
+    sf->line_starts = NULL;
+    sf->line_numbers = NULL;
+    sf->num_lines = 0;
+    sf->num_starts = 0;
+    sf->lines_cap = 0;
+    sf->tail_ends = NULL;
+    sf->num_tails = 0;
+    sf->tails_cap = 0;
+    sf->last_line = 0;
+    return num_files++;
+}
+
+// Record that the given line of file starts at the given offset
+void file_location_add_line(unsigned int file, unsigned int offset,
+			    unsigned int line)
+{
+    source_file *sf = &files[file];
+    if (sf->num_lines > 0 && (line <= sf->line_numbers[sf->num_lines - 1]
+			      || offset < sf->line_starts[sf->num_lines - 1])) {
+	// already recorded (or out of order, so ignored)
+	return;
+    }
+    if (sf->num_lines == sf->lines_cap) {
+	sf->lines_cap = (sf->lines_cap == 0) ? 64 : 2 * sf->lines_cap;
+	sf->line_starts = (unsigned int *) realloc(sf->line_starts,
+				       sf->lines_cap * sizeof(unsigned int));
+	sf->line_numbers = (unsigned int *) realloc(sf->line_numbers,
+				       sf->lines_cap * sizeof(unsigned int));
+	if (sf->line_starts == NULL || sf->line_numbers == NULL) {
+	    bail_with_error("No space for the lines of %s!", sf->name);
+	}
+    }
+    sf->line_starts[sf->num_lines] = offset;
+    sf->line_numbers[sf->num_lines] = line;
+    sf->num_lines++;
+    sf->num_starts++;
+}
+
+// Make the contents of file be the split chars at text
+// followed by the len - split chars at rest
+void file_location_set_text(unsigned int file, const char *text,
+			    size_t split, const char *rest, size_t len)
+{
+    source_file *sf = &files[file];
+    sf->text = text;
+    sf->split = split;
+    sf->rest = rest;
+    sf->len = len;
+}
+
+// Add a line starting at offset to the lines in sf's line_starts
+static void push_start(source_file *sf, unsigned int offset)
+{
+    if (sf->num_starts == sf->lines_cap) {
+	sf->lines_cap = (sf->lines_cap == 0) ? 64 : 2 * sf->lines_cap;
+	sf->line_starts = (unsigned int *) realloc(sf->line_starts,
+				       sf->lines_cap * sizeof(unsigned int));
+	if (sf->line_starts == NULL) {
+	    bail_with_error("No space for the lines of %s!", sf->name);
+	}
+    }
+    sf->line_starts[sf->num_starts++] = offset;
+}
+
+// Add a line whose start is end chars before the end of sf's text
+// to the lines in sf's tail_ends (as the earliest of them)
+static void push_tail(source_file *sf, unsigned int end)
+{
+    if (sf->num_tails == sf->tails_cap) {
+	sf->tails_cap = (sf->tails_cap == 0) ? 64 : 2 * sf->tails_cap;
+	sf->tail_ends = (unsigned int *) realloc(sf->tail_ends,
+				       sf->tails_cap * sizeof(unsigned int));
+	if (sf->tail_ends == NULL) {
+	    bail_with_error("No space for the lines of %s!", sf->name);
+	}
+    }
+    sf->tail_ends[sf->num_tails++] = end;
+}
+
+// Return the start of the earliest line in sf's tail_ends
+static inline unsigned int first_tail_start(const source_file *sf)
+{
+    return (unsigned int) sf->len - sf->tail_ends[sf->num_tails - 1];
+}
+
+// Record that the chars of file from offset start up to offset end
+// were replaced by the len chars at text
+void file_location_replace(unsigned int file, unsigned int start,
+			   unsigned int end, const char *text, size_t len)
+{
+    source_file *sf = &files[file];
+    if (sf->line_starts == NULL) {
+	// the index will be built from the new text when needed
+	sf->len = sf->len - (end - start) + len;
+	return;
+    }
+    // make line_starts hold just the lines starting at or before start
+    while (sf->num_starts > 1 && sf->line_starts[sf->num_starts - 1] > start) {
+	sf->num_starts--;
+	push_tail(sf, (unsigned int) sf->len - sf->line_starts[sf->num_starts]);
+    }
+    while (sf->num_tails > 0 && first_tail_start(sf) <= start) {
+	unsigned int offset = first_tail_start(sf);
+	sf->num_tails--;
+	push_start(sf, offset);
+    }
+    // forget the lines whose newline was replaced
+    while (sf->num_tails > 0 && first_tail_start(sf) <= end) {
+	sf->num_tails--;
+    }
+    // add the lines whose newline is in text
+    for (const char *nl = memchr(text, '\n', len); nl != NULL;
+	 nl = memchr(nl + 1, '\n', text + len - (nl + 1))) {
+	push_start(sf, start + (unsigned int) (nl - text) + 1);
+    }
+    sf->num_lines = sf->num_starts + sf->num_tails;
+    sf->len = sf->len - (end - start) + len;
+    sf->last_line = 0;
+}
+
+// Forget all the source files recorded by the calling thread
+void file_location_clear_files()
+{
+    for (unsigned int i = 0; i < num_files; i++) {
+	free(files[i].line_starts);
+	free(files[i].line_numbers);
+	free(files[i].tail_ends);
+    }
+    free(files);
+    files = NULL;
+    num_files = 0;
+    files_cap = 0;
+}
+
+// Return the name of floc's file
+const char *file_location_filename(file_location floc)
+{
+    return files[floc.file].name;
+}
+
+// Build the index of where sf's lines start
+static void build_line_starts(source_file *sf)
+{
+    push_start(sf, 0);
+    const char *piece = sf->text;
+    size_t piece_len = sf->split, piece_offset = 0;
+    for (int i = 0; i < 2; i++) {
+	const char *end = piece + piece_len;
+	for (const char *nl = memchr(piece, '\n', piece_len); nl != NULL;
+	     nl = memchr(nl + 1, '\n', end - (nl + 1))) {
+	    push_start(sf, (unsigned int) (piece_offset + (nl - piece) + 1));
+	}
+	piece = sf->rest;
+	piece_len = sf->len - sf->split;
+	piece_offset = sf->split;
+	if (piece_len == 0) {
+	    break;
+	}
+    }
+    sf->num_lines = sf->num_starts;
+}
+
+// Return the offset where the line with index i of sf starts
+static inline unsigned int line_start(const source_file *sf, unsigned int i)
+{
+    if (i < sf->num_starts) {
+	return sf->line_starts[i];
+    }
+    return (unsigned int) sf->len - sf->tail_ends[sf->num_lines - 1 - i];
+}
+
+// Return the index (from 0) of the line of sf holding offset
+static unsigned int line_index(source_file *sf, unsigned int offset)
+{
+    if (sf->line_starts == NULL) {
+	if (sf->text == NULL) {
+	    // no lines are known, so all is on the first line
+	    file_location_add_line((unsigned int) (sf - files), 0, 1);
+	} else {
+	    build_line_starts(sf);
+	}
+    }
+    unsigned int i = sf->last_line;
+    // locations are mostly asked for in order, so try near the last one
+    if (line_start(sf, i) <= offset) {
+	if (i + 1 == sf->num_lines || offset < line_start(sf, i + 1)) {
+	    return i;
+	}
+	if (i + 2 == sf->num_lines || offset < line_start(sf, i + 2)) {
+	    sf->last_line = i + 1;
+	    return i + 1;
+	}
+    }
+    // otherwise find the last line starting at or before offset
+    unsigned int lo = 0, hi = sf->num_lines;
+    while (hi - lo > 1) {
+	unsigned int mid = lo + (hi - lo) / 2;
+	if (line_start(sf, mid) <= offset) {
+	    lo = mid;
+	} else {
+	    hi = mid;
+	}
+    }
+    sf->last_line = lo;
+    return lo;
+}
+
+// Return the line number (counting from 1) of floc
+unsigned int file_location_line(file_location floc)
+{
+    source_file *sf = &files[floc.file];
+    unsigned int i = line_index(sf, floc.offset);
+    return (sf->line_numbers == NULL) ? i + 1 : sf->line_numbers[i];
+}
+
+// Return the column number (counting from 1) of floc
+unsigned int file_location_column(file_location floc)
+{
+    source_file *sf = &files[floc.file];
+    unsigned int i = line_index(sf, floc.offset);
+    return floc.offset - line_start(sf, i) + 1;
+}
@@ -1,16 +1,68 @@
-/* $Id: file_location.h,v 1.1 2023/02/19 03:07:27 leavens Exp $ */
-#ifndef _FILE_LOCATION_H
-#define _FILE_LOCATION_H
-#include "token.h"
-
-// location in a source file (useful for error messages)
-typedef struct {
-    const char *filename;
-    unsigned int line; // of first token
-    unsigned int column; // of first token
-} file_location;
-
-// Return the file location information from a token
-extern file_location token2file_loc(token t);
-
-#endif
+/* $Id: file_location.h,v 1.1 2023/02/19 03:07:27 leavens Exp $ */
+#ifndef _FILE_LOCATION_H
+#define _FILE_LOCATION_H
+#include <stddef.h>
+#include "token.h"
+
+// location in a source file (useful for error messages);
+// the line and column are computed from the offset only when needed
+typedef struct {
+    unsigned int file; // id of the source file (see file_location_add_file)
+    unsigned int offset; // in bytes from the file's start, of first token
+} file_location;
+
+// Return the file location information from a token
+extern file_location token2file_loc(token t);
+
+// Requires: name and the len bytes at text stay valid
+//           until the next call of file_location_clear_files()
+// Record (for the calling thread) a source file with the given name
+// and contents, and return its id
+extern unsigned int file_location_add_file(const char *name,
+					   const char *text, size_t len);
+
+// Requires: file was recorded (by the calling thread) without its
+//           contents (text == NULL), and line is larger than
+//           the line numbers recorded for it so far
+// Record that the given line of file starts at the given offset
+// (for files whose contents are not at hand, such as those read
+// as token streams, only the lines recorded can be found)
+extern void file_location_add_line(unsigned int file, unsigned int offset,
+				   unsigned int line);
+
+// Requires: file was recorded (by the calling thread) with its contents,
+//           and text and rest stay valid as file_location_add_file says
+// Make the contents of file be the first split chars at text followed
+// by the len - split chars at rest (so a text being edited need not be
+// kept in one piece); the lines of the file are as file_location_replace
+// last recorded them
+extern void file_location_set_text(unsigned int file, const char *text,
+				   size_t split, const char *rest, size_t len);
+
+// Requires: file was recorded (by the calling thread) with its contents,
+//           and start <= end <= the length of those contents
+// Record that the chars of file from offset start up to (but not including)
+// offset end were replaced by the len chars at text, which moves
+// the lines after them; this takes time proportional to the number of
+// lines replaced or passed since the last such edit, not to the file's size.
+// (The caller then gives the new contents with file_location_set_text.)
+extern void file_location_replace(unsigned int file, unsigned int start,
+				  unsigned int end, const char *text,
+				  size_t len);
+
+// Forget all the source files recorded by the calling thread
+extern void file_location_clear_files();
+
+// Requires: floc's file is recorded by the calling thread
+// Return the name of floc's file
+extern const char *file_location_filename(file_location floc);
+
+// Requires: floc's file is recorded by the calling thread
+// Return the line number (counting from 1) of floc
+extern unsigned int file_location_line(file_location floc);
+
+// Requires: floc's file is recorded by the calling thread
+// Return the column number (counting from 1) of floc
+extern unsigned int file_location_column(file_location floc);
+
+#endif
@@ -0,0 +1,387 @@
+// Compact, index-based (flat) ASTs
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utilities.h"
+#include "flat_ast.h"
+
+// Initial room for nodes in a flat_ast
+#define FLAT_INITIAL_NODES 256
+
+// State used while converting a pointer AST into a flat_ast
+typedef struct {
+    flat_ast *fa;
+    uint32_t nodes_cap;
+    uint32_t lists_cap;
+    uint32_t names_cap;
+    // open-addressing table mapping (interned) name pointers
+    // to 1 + their index in fa->names (0 for an empty slot)
+    uint32_t *name_slots;
+    uint32_t name_slots_cap;
+} flattener;
+
+// Return p resized to hold cap elements of elem_size bytes,
+// bailing with an error message if there is no space
+static void *flat_resize(void *p, size_t cap, size_t elem_size)
+{
+    void *ret = realloc(p, cap * elem_size);
+    if (ret == NULL) {
+	bail_with_error("No space for flat AST!");
+    }
+    return ret;
+}
+
+// Return the slot of name in fl's name table
+// (or the empty slot where it belongs)
+static uint32_t flat_name_slot(flattener *fl, const char *name)
+{
+    uintptr_t p = (uintptr_t) name;
+    uint32_t mask = fl->name_slots_cap - 1;
+    uint32_t i = (uint32_t) ((p ^ (p >> 16)) * 2654435761u) & mask;
+    while (fl->name_slots[i] != 0
+	   && fl->fa->names[fl->name_slots[i] - 1] != name) {
+	i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Return the index of the given (interned) name in fl's names table,
+// adding it (with the given offset) if necessary
+static uint32_t flat_name(flattener *fl, const char *name, unsigned int offset)
+{
+    flat_ast *fa = fl->fa;
+    uint32_t slot = flat_name_slot(fl, name);
+    if (fl->name_slots[slot] != 0) {
+	return fl->name_slots[slot] - 1;
+    }
+    if (fa->num_names == fl->names_cap) {
+	fl->names_cap *= 2;
+	fa->names = flat_resize(fa->names, fl->names_cap, sizeof(const char *));
+	fa->offsets = flat_resize(fa->offsets, fl->names_cap, sizeof(uint32_t));
+    }
+    fa->names[fa->num_names] = name;
+    fa->offsets[fa->num_names] = offset;
+    fl->name_slots[slot] = ++fa->num_names;
+    // keep the name table at most half full
+    if (2 * fa->num_names > fl->name_slots_cap) {
+	free(fl->name_slots);
+	fl->name_slots_cap *= 2;
+	fl->name_slots = calloc(fl->name_slots_cap, sizeof(uint32_t));
+	if (fl->name_slots == NULL) {
+	    bail_with_error("No space for flat AST!");
+	}
+	for (uint32_t i = 0; i < fa->num_names; i++) {
+	    fl->name_slots[flat_name_slot(fl, fa->names[i])] = i + 1;
+	}
+    }
+    return fa->num_names - 1;
+}
+
+// Return the index of a new node for ast (with only its type tag
+// and location filled in) at the end of fl's nodes
+static flat_index flat_new_node(flattener *fl, AST *ast)
+{
+    flat_ast *fa = fl->fa;
+    if (fa->num_nodes == fl->nodes_cap) {
+	fl->nodes_cap *= 2;
+	fa->nodes = flat_resize(fa->nodes, fl->nodes_cap, sizeof(flat_node));
+    }
+    flat_node *n = &fa->nodes[fa->num_nodes];
+    memset(n, 0, sizeof(flat_node));
+    n->type_tag = (uint8_t) ast->type_tag;
+    if (ast->file_loc.file > UINT16_MAX) {
+	bail_with_error("Too many files for a flat AST!");
+    }
+    n->file = (uint16_t) ast->file_loc.file;
+    n->offset = ast->file_loc.offset;
+    return fa->num_nodes++;
+}
+
+// Return the index of the start of count fresh elements
+// at the end of fl's lists
+static uint32_t flat_new_list(flattener *fl, uint32_t count)
+{
+    flat_ast *fa = fl->fa;
+    while (fa->num_lists + count > fl->lists_cap) {
+	fl->lists_cap *= 2;
+	fa->lists = flat_resize(fa->lists, fl->lists_cap, sizeof(flat_index));
+    }
+    uint32_t ret = fa->num_lists;
+    fa->num_lists += count;
+    return ret;
+}
+
+// Add (the flat form of) ast and all its descendents to fl's nodes,
+// returning the index of ast's node
+static flat_index flatten(flattener *fl, AST *ast)
+{
+    flat_index ret = flat_new_node(fl, ast);
+    flat_index kid;
+    // N is re-evaluated after each recursive call, as the nodes may move
+#define N (&fl->fa->nodes[ret])
+    switch (ast->type_tag) {
+    case program_ast: {
+	uint32_t ncds = 0, nvds = 0;
+	AST_list l;
+	for (l = ast->data.program.cds; !ast_list_is_empty(l);
+	     l = ast_list_rest(l)) {
+	    flatten(fl, ast_list_first(l));
+	    ncds++;
+	}
+	for (l = ast->data.program.vds; !ast_list_is_empty(l);
+	     l = ast_list_rest(l)) {
+	    flatten(fl, ast_list_first(l));
+	    nvds++;
+	}
+	kid = flatten(fl, ast->data.program.stmt);
+	N->u.kids.a = ncds;
+	N->u.kids.b = nvds;
+	N->u.kids.c = kid;
+	break;
+    }
+    case const_decl_ast:
+	N->u.named.name = flat_name(fl, ast->data.const_decl.name,
+				     ast->data.const_decl.offset);
+	N->u.named.num = ast->data.const_decl.num_val;
+	N->u.named.kid = FLAT_NONE;
+	break;
+    case var_decl_ast:
+	N->u.named.name = flat_name(fl, ast->data.var_decl.name,
+				     ast->data.var_decl.offset);
+	N->u.named.kid = FLAT_NONE;
+	break;
+    case assign_ast:
+	N->u.named.name = flat_name(fl, ast->data.assign_stmt.name,
+				     ast->data.assign_stmt.offset);
+	kid = flatten(fl, ast->data.assign_stmt.exp);
+	N->u.named.kid = kid;
+	break;
+    case begin_ast: {
+	uint32_t count = 0;
+	AST_list l;
+	for (l = ast->data.begin_stmt.stmts; !ast_list_is_empty(l);
+	     l = ast_list_rest(l)) {
+	    count++;
+	}
+	uint32_t start = flat_new_list(fl, count);
+	N->u.range.start = start;
+	N->u.range.count = count;
+	uint32_t i = start;
+	for (l = ast->data.begin_stmt.stmts; !ast_list_is_empty(l);
+	     l = ast_list_rest(l)) {
+	    kid = flatten(fl, ast_list_first(l));
+	    fl->fa->lists[i++] = kid;
+	}
+	break;
+    }
+    case if_ast:
+	kid = flatten(fl, ast->data.if_stmt.cond);
+	N->u.kids.a = kid;
+	kid = flatten(fl, ast->data.if_stmt.thenstmt);
+	N->u.kids.b = kid;
+	kid = flatten(fl, ast->data.if_stmt.elsestmt);
+	N->u.kids.c = kid;
+	break;
+    case while_ast:
+	kid = flatten(fl, ast->data.while_stmt.cond);
+	N->u.kids.a = kid;
+	kid = flatten(fl, ast->data.while_stmt.stmt);
+	N->u.kids.b = kid;
+	N->u.kids.c = FLAT_NONE;
+	break;
+    case read_ast:
+	N->u.named.name = flat_name(fl, ast->data.read_stmt.name,
+				     ast->data.read_stmt.offset);
+	N->u.named.kid = FLAT_NONE;
+	break;
+    case write_ast:
+	kid = flatten(fl, ast->data.write_stmt.exp);
+	N->u.kids.a = kid;
+	break;
+    case skip_ast:
+	break;
+    case odd_cond_ast:
+	kid = flatten(fl, ast->data.odd_cond.exp);
+	N->u.kids.a = kid;
+	break;
+    case bin_cond_ast:
+	N->op = (uint8_t) ast->data.bin_cond.relop;
+	kid = flatten(fl, ast->data.bin_cond.leftexp);
+	N->u.kids.a = kid;
+	kid = flatten(fl, ast->data.bin_cond.rightexp);
+	N->u.kids.b = kid;
+	break;
+    case op_expr_ast:
+	N->op = (uint8_t) ast->data.op_expr.arith_op;
+	kid = flatten(fl, ast->data.op_expr.exp);
+	N->u.kids.a = kid;
+	break;
+    case bin_expr_ast:
+	N->op = (uint8_t) ast->data.bin_expr.arith_op;
+	kid = flatten(fl, ast->data.bin_expr.leftexp);
+	N->u.kids.a = kid;
+	kid = flatten(fl, ast->data.bin_expr.rightexp);
+	N->u.kids.b = kid;
+	break;
+    case ident_ast:
+	N->u.named.name = flat_name(fl, ast->data.ident.name,
+				     ast->data.ident.offset);
+	N->u.named.kid = FLAT_NONE;
+	break;
+    case number_ast:
+	N->u.named.num = ast->data.number.value;
+	N->u.named.kid = FLAT_NONE;
+	break;
+    default:
+	bail_with_error("Unexpected type_tag %d in flatten!", ast->type_tag);
+	break;
+    }
+#undef N
+    return ret;
+}
+
+// Return a freshly allocated flat encoding of prog.
+flat_ast *flat_ast_from_ast(AST *prog)
+{
+    flat_ast *fa = (flat_ast *) calloc(1, sizeof(flat_ast));
+    if (fa == NULL) {
+	bail_with_error("No space for flat AST!");
+    }
+    flattener fl;
+    fl.fa = fa;
+    fl.nodes_cap = FLAT_INITIAL_NODES;
+    fl.lists_cap = FLAT_INITIAL_NODES;
+    fl.names_cap = FLAT_INITIAL_NODES;
+    fl.name_slots_cap = 2 * FLAT_INITIAL_NODES;
+    fa->nodes = flat_resize(NULL, fl.nodes_cap, sizeof(flat_node));
+    fa->lists = flat_resize(NULL, fl.lists_cap, sizeof(flat_index));
+    fa->names = flat_resize(NULL, fl.names_cap, sizeof(const char *));
+    fa->offsets = flat_resize(NULL, fl.names_cap, sizeof(uint32_t));
+    fl.name_slots = calloc(fl.name_slots_cap, sizeof(uint32_t));
+    if (fl.name_slots == NULL) {
+	bail_with_error("No space for flat AST!");
+    }
+    flatten(&fl, prog);
+    free(fl.name_slots);
+    return fa;
+}
+
+// Return a token carrying the location of the flat node n
+// (as the AST constructors take their locations from tokens)
+static token flat_loc_token(flat_node *n)
+{
+    token t;
+    t.typ = eofsym;
+    t.file = n->file;
+    t.offset = n->offset;
+    t.text = NULL;
+    t.value = 0;
+    return t;
+}
+
+// Return a fresh (pointer) AST for the node at index i in fa
+static AST *unflatten(flat_ast *fa, flat_index i)
+{
+    flat_node *n = &fa->nodes[i];
+    token t = flat_loc_token(n);
+    AST *ret;
+    switch (n->type_tag) {
+    case program_ast: {
+	AST_list lists[2] = { ast_list_empty_list(), ast_list_empty_list() };
+	uint32_t counts[2] = { n->u.kids.a, n->u.kids.b };
+	flat_index d = i + 1;
+	for (int k = 0; k < 2; k++) {
+	    AST_list last = ast_list_empty_list();
+	    for (uint32_t j = 0; j < counts[k]; j++, d++) {
+		AST *decl = unflatten(fa, d);
+		if (ast_list_is_empty(last)) {
+		    lists[k] = decl;
+		} else {
+		    ast_list_splice(last, decl);
+		}
+		last = decl;
+	    }
+	}
+	return ast_program(token2file_loc(t), lists[0], lists[1],
+			   unflatten(fa, n->u.kids.c));
+    }
+    case const_decl_ast:
+	ret = ast_const_def(t, fa->names[n->u.named.name], n->u.named.num);
+	ret->data.const_decl.offset = fa->offsets[n->u.named.name];
+	return ret;
+    case var_decl_ast:
+	ret = ast_var_decl(t, fa->names[n->u.named.name]);
+	ret->data.var_decl.offset = fa->offsets[n->u.named.name];
+	return ret;
+    case assign_ast:
+	ret = ast_assign_stmt(t, fa->names[n->u.named.name],
+			      unflatten(fa, n->u.named.kid));
+	ret->data.assign_stmt.offset = fa->offsets[n->u.named.name];
+	return ret;
+    case begin_ast: {
+	AST_list stmts = ast_list_empty_list();
+	AST_list last = ast_list_empty_list();
+	for (uint32_t j = 0; j < n->u.range.count; j++) {
+	    AST *s = unflatten(fa, fa->lists[n->u.range.start + j]);
+	    if (ast_list_is_empty(last)) {
+		stmts = s;
+	    } else {
+		ast_list_splice(last, s);
+	    }
+	    last = s;
+	}
+	return ast_begin_stmt(t, stmts);
+    }
+    case if_ast:
+	return ast_if_stmt(t, unflatten(fa, n->u.kids.a),
+			   unflatten(fa, n->u.kids.b),
+			   unflatten(fa, n->u.kids.c));
+    case while_ast:
+	return ast_while_stmt(t, unflatten(fa, n->u.kids.a),
+			      unflatten(fa, n->u.kids.b));
+    case read_ast:
+	ret = ast_read_stmt(t, fa->names[n->u.named.name]);
+	ret->data.read_stmt.offset = fa->offsets[n->u.named.name];
+	return ret;
+    case write_ast:
+	return ast_write_stmt(t, unflatten(fa, n->u.kids.a));
+    case skip_ast:
+	return ast_skip_stmt(t);
+    case odd_cond_ast:
+	return ast_odd_cond(t, unflatten(fa, n->u.kids.a));
+    case bin_cond_ast:
+	return ast_bin_cond(t, unflatten(fa, n->u.kids.a), (rel_op) n->op,
+			    unflatten(fa, n->u.kids.b));
+    case op_expr_ast:
+	return ast_op_expr(t, (bin_arith_op) n->op, unflatten(fa, n->u.kids.a));
+    case bin_expr_ast:
+	return ast_bin_expr(t, unflatten(fa, n->u.kids.a),
+			    (bin_arith_op) n->op, unflatten(fa, n->u.kids.b));
+    case ident_ast:
+	ret = ast_ident(t, fa->names[n->u.named.name]);
+	ret->data.ident.offset = fa->offsets[n->u.named.name];
+	return ret;
+    case number_ast:
+	return ast_number(t, n->u.named.num);
+    default:
+	bail_with_error("Unexpected type_tag %d in unflatten!", n->type_tag);
+	break;
+    }
+    return NULL;
+}
+
+// Return a (pointer to a) fresh program AST equivalent to fa
+AST *flat_ast_to_ast(flat_ast *fa)
+{
+    return unflatten(fa, 0);
+}
+
+// Give back the storage of fa (but not of the names it refers to)
+void flat_ast_free(flat_ast *fa)
+{
+    free(fa->nodes);
+    free(fa->lists);
+    free(fa->names);
+    free(fa->offsets);
+    free(fa);
+}
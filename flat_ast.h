@@ -0,0 +1,93 @@
+#ifndef _FLAT_AST_H
+#define _FLAT_AST_H
+#include <stdint.h>
+#include "ast.h"
+
+// A compact, index-based encoding of the ASTs of ast.h.
+// All nodes of a program are kept in one contiguous array,
+// in preorder (so each node comes before its children),
+// children are referred to by 32-bit indexes into that array,
+// lists are (start, count) ranges, names are indexes into a table
+// of (interned) names (which also holds the offsets of their declarations,
+// as there is only one scope), and file locations are a small file id
+// plus a byte offset (as in file_location.h).
+// The ASTs of ast.h can be converted to and from this form,
+// so the unparser and scope checker can be run on either.
+
+// An index of a node in a flat_ast's nodes array
+typedef uint32_t flat_index;
+
+// The index used for "no node"
+#define FLAT_NONE UINT32_MAX
+
+// A node of a flat AST.  Which fields of the union are used depends
+// on type_tag, as follows (where decls follow the program node):
+//  program_ast:    a = number of const-decls, b = number of var-decls,
+//                  c = the statement; the decls are the nodes right
+//                  after the program, const-decls first
+//  const_decl_ast: name, num
+//  var_decl_ast:   name
+//  assign_ast:     name, kid (the expression)
+//  begin_ast:      range (in the flat_ast's lists array)
+//  if_ast:         a = condition, b = then statement, c = else statement
+//  while_ast:      a = condition, b = body
+//  read_ast:       name
+//  write_ast:      a = expression
+//  skip_ast:       nothing
+//  odd_cond_ast:   a = expression
+//  bin_cond_ast:   a = left expression, op = rel_op, b = right expression
+//  op_expr_ast:    a = expression, op = bin_arith_op
+//  bin_expr_ast:   a = left expression, op = bin_arith_op,
+//                  b = right expression
+//  ident_ast:      name
+//  number_ast:     num
+typedef struct {
+    uint8_t type_tag; // an AST_type
+    uint8_t op;       // a rel_op or bin_arith_op
+    uint16_t file;    // the file id (see file_location.h)
+    uint32_t offset;  // in bytes from the start of the file
+    union {
+	struct {
+	    flat_index a;
+	    flat_index b;
+	    flat_index c;
+	} kids;
+	struct {
+	    uint32_t start;
+	    uint32_t count;
+	} range;
+	struct {
+	    uint32_t name; // index in the flat_ast's names table
+	    flat_index kid;
+	    int16_t num;
+	} named;
+    } u;
+} flat_node;
+
+// A whole program in flat form
+typedef struct {
+    flat_node *nodes;       // nodes[0] is the program
+    uint32_t num_nodes;
+    flat_index *lists;      // elements of begin statements' lists
+    uint32_t num_lists;
+    const char **names;     // the distinct (interned) names used
+    uint32_t *offsets;      // offsets[i] is the offset of names[i]'s
+                            // declaration (as set by the scope checker)
+    uint32_t num_names;
+} flat_ast;
+
+// Requires: prog is a (pointer to a) program AST
+// Return a freshly allocated flat encoding of prog.
+// Names are shared with prog (so they are still interned).
+// If there is no space, bail with an error message,
+// so this never returns NULL.
+extern flat_ast *flat_ast_from_ast(AST *prog);
+
+// Requires: fa was returned by flat_ast_from_ast
+// Return a (pointer to a) fresh program AST equivalent to fa
+extern AST *flat_ast_to_ast(flat_ast *fa);
+
+// Give back the storage of fa (but not of the names it refers to)
+extern void flat_ast_free(flat_ast *fa);
+
+#endif
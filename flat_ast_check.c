@@ -0,0 +1,38 @@
+// Check of the flat form of ASTs (see flat_ast.h): parse the given file,
+// convert its AST to flat form and back, and then do with that AST
+// what the compiler does by default (unparse it, then scope check it),
+// so the output should be the same as the compiler's
+// (see the check-flat-ast target in the Makefile).
+#include <stdio.h>
+#include <stdlib.h>
+#include "utilities.h"
+#include "parser_api.h"
+#include "scope_check.h"
+#include "scope_symtab.h"
+#include "unparser.h"
+#include "flat_ast.h"
+
+// the compiler's own main is renamed (with -Dmain=compiler_main)
+// when it is linked into this check
+#undef main
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+	fprintf(stderr, "Usage: %s code-filename\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    parser_open(argv[1]);
+    AST *progast = parseProgram();
+    parser_close();
+    flat_ast *fa = flat_ast_from_ast(progast);
+    AST *copy = flat_ast_to_ast(fa);
+    flat_ast_free(fa);
+    unparseProgram(stdout, copy);
+    fflush(stdout);
+    scope_initialize();
+    scope_check_program(copy);
+    scope_finalize();
+    ast_arena_release();
+    return EXIT_SUCCESS;
+}
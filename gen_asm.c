@@ -0,0 +1,205 @@
+// Generation of x86-64 assembly code from checked ASTs
+#include <stdlib.h>
+#include "utilities.h"
+#include "gen_asm.h"
+
+// Each value is a short in a 2 byte frame slot below %rbp,
+// and expressions leave their value (sign extended) in %eax,
+// with pending left operands saved on the machine stack.
+
+static _Thread_local FILE *asm_out;
+// number of the next label to be generated
+static _Thread_local unsigned int next_label;
+
+static void gen_asm_stmt(AST *stmt);
+static void gen_asm_cond(AST *cond, unsigned int false_label);
+static void gen_asm_expr(AST *exp);
+
+// Return the frame slot operand of the variable at offset
+static int gen_asm_slot(unsigned int offset)
+{
+    return -2 * (int) (offset + 1);
+}
+
+// Write to out a string literal for s (in GNU as syntax)
+static void gen_asm_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+	if (*s == '"' || *s == '\\') {
+	    fputc('\\', out);
+	}
+	fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+// Write to out the assembly code for prog, defining main
+void gen_asm_program(FILE *out, AST *prog)
+{
+    asm_out = out;
+    next_label = 0;
+    unsigned int frame_size = 0;
+    AST_list l;
+    for (l = prog->data.program.cds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	frame_size++;
+    }
+    for (l = prog->data.program.vds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	frame_size++;
+    }
+    // keep %rsp 16 byte aligned for calls
+    unsigned int frame_bytes = (2 * frame_size + 15) & ~15u;
+
+    fprintf(out, "\t.section .rodata\n.Lfilename:\n\t.string ");
+    gen_asm_string(out, file_location_filename(prog->file_loc));
+    fprintf(out, "\n\t.text\n\t.globl main\n\t.type main, @function\nmain:\n");
+    fprintf(out, "\tpushq %%rbp\n\tmovq %%rsp, %%rbp\n");
+    if (frame_bytes > 0) {
+	fprintf(out, "\tsubq $%u, %%rsp\n", frame_bytes);
+	fprintf(out, "\tmovq %%rsp, %%rdi\n\tmovl $%u, %%ecx\n"
+		"\txorl %%eax, %%eax\n\trep stosb\n", frame_bytes);
+    }
+    for (l = prog->data.program.cds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	AST *cd = ast_list_first(l);
+	fprintf(out, "\tmovw $%d, %d(%%rbp)\n", cd->data.const_decl.num_val,
+		gen_asm_slot(cd->data.const_decl.offset));
+    }
+    gen_asm_stmt(prog->data.program.stmt);
+    fprintf(out, "\txorl %%eax, %%eax\n\tleave\n\tret\n");
+    fprintf(out, "\t.size main, .-main\n");
+    fprintf(out, "\t.section .note.GNU-stack,\"\",@progbits\n");
+}
+
+// Write the code for the statement stmt
+static void gen_asm_stmt(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	gen_asm_expr(stmt->data.assign_stmt.exp);
+	fprintf(asm_out, "\tmovw %%ax, %d(%%rbp)\n",
+		gen_asm_slot(stmt->data.assign_stmt.offset));
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    gen_asm_stmt(ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast: {
+	unsigned int else_label = next_label++;
+	unsigned int end_label = next_label++;
+	gen_asm_cond(stmt->data.if_stmt.cond, else_label);
+	gen_asm_stmt(stmt->data.if_stmt.thenstmt);
+	fprintf(asm_out, "\tjmp .L%u\n.L%u:\n", end_label, else_label);
+	gen_asm_stmt(stmt->data.if_stmt.elsestmt);
+	fprintf(asm_out, ".L%u:\n", end_label);
+	break;
+    }
+    case while_ast: {
+	unsigned int start_label = next_label++;
+	unsigned int end_label = next_label++;
+	fprintf(asm_out, ".L%u:\n", start_label);
+	gen_asm_cond(stmt->data.while_stmt.cond, end_label);
+	gen_asm_stmt(stmt->data.while_stmt.stmt);
+	fprintf(asm_out, "\tjmp .L%u\n.L%u:\n", start_label, end_label);
+	break;
+    }
+    case read_ast:
+	fprintf(asm_out, "\tcall pl0_read\n\tmovw %%ax, %d(%%rbp)\n",
+		gen_asm_slot(stmt->data.read_stmt.offset));
+	break;
+    case write_ast:
+	gen_asm_expr(stmt->data.write_stmt.exp);
+	fprintf(asm_out, "\tmovl %%eax, %%edi\n\tcall pl0_write\n");
+	break;
+    case skip_ast:
+	break;
+    default:
+	bail_with_error("Call to gen_asm_stmt with an AST that is not a statement!");
+	break;
+    }
+}
+
+// Write the code for the condition cond,
+// which jumps to false_label when cond is false
+static void gen_asm_cond(AST *cond, unsigned int false_label)
+{
+    switch (cond->type_tag) {
+    case odd_cond_ast:
+	gen_asm_expr(cond->data.odd_cond.exp);
+	fprintf(asm_out, "\ttestl $1, %%eax\n\tjz .L%u\n", false_label);
+	break;
+    case bin_cond_ast: {
+	// the jumps taken when each rel_op is false
+	static const char *false_jumps[] =
+	    {"jne", "je", "jge", "jg", "jle", "jl"};
+	gen_asm_expr(cond->data.bin_cond.leftexp);
+	fprintf(asm_out, "\tpushq %%rax\n");
+	gen_asm_expr(cond->data.bin_cond.rightexp);
+	fprintf(asm_out, "\tmovl %%eax, %%ecx\n\tpopq %%rax\n"
+		"\tcmpl %%ecx, %%eax\n\t%s .L%u\n",
+		false_jumps[cond->data.bin_cond.relop], false_label);
+	break;
+    }
+    default:
+	bail_with_error("Unexpected type_tag %d in gen_asm_cond!",
+			cond->type_tag);
+	break;
+    }
+}
+
+// Write the code for the expression exp,
+// which leaves its value in %eax
+static void gen_asm_expr(AST *exp)
+{
+    switch (exp->type_tag) {
+    case bin_expr_ast: {
+	gen_asm_expr(exp->data.bin_expr.leftexp);
+	fprintf(asm_out, "\tpushq %%rax\n");
+	gen_asm_expr(exp->data.bin_expr.rightexp);
+	fprintf(asm_out, "\tmovl %%eax, %%ecx\n\tpopq %%rax\n");
+	switch (exp->data.bin_expr.arith_op) {
+	case addop:
+	    fprintf(asm_out, "\taddl %%ecx, %%eax\n");
+	    break;
+	case subop:
+	    fprintf(asm_out, "\tsubl %%ecx, %%eax\n");
+	    break;
+	case multop:
+	    fprintf(asm_out, "\timull %%ecx, %%eax\n");
+	    break;
+	case divop: {
+	    unsigned int ok_label = next_label++;
+	    fprintf(asm_out, "\ttestl %%ecx, %%ecx\n\tjnz .L%u\n", ok_label);
+	    fprintf(asm_out, "\tleaq .Lfilename(%%rip), %%rdi\n"
+		    "\tmovl $%u, %%esi\n\tmovl $%u, %%edx\n"
+		    "\tandq $-16, %%rsp\n\tcall pl0_div_by_zero\n",
+		    file_location_line(exp->file_loc),
+		    file_location_column(exp->file_loc));
+	    fprintf(asm_out, ".L%u:\n\tcltd\n\tidivl %%ecx\n", ok_label);
+	    break;
+	}
+	default:
+	    bail_with_error("Unexpected bin_arith_op %d in gen_asm_expr",
+			    exp->data.bin_expr.arith_op);
+	    break;
+	}
+	// values are shorts, so arithmetic wraps around
+	fprintf(asm_out, "\tmovswl %%ax, %%eax\n");
+	break;
+    }
+    case ident_ast:
+	fprintf(asm_out, "\tmovswl %d(%%rbp), %%eax\n",
+		gen_asm_slot(exp->data.ident.offset));
+	break;
+    case number_ast:
+	fprintf(asm_out, "\tmovl $%d, %%eax\n", exp->data.number.value);
+	break;
+    default:
+	bail_with_error("Unexpected type_tag %d in gen_asm_expr!",
+			exp->type_tag);
+	break;
+    }
+}
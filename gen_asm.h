@@ -0,0 +1,13 @@
+#ifndef _GEN_ASM_H
+#define _GEN_ASM_H
+#include <stdio.h>
+#include "ast.h"
+
+// Requires: prog is a program AST that has been scope checked
+// (so the offsets of names in it are filled in) and out is open for writing
+// Write to out x86-64 assembly code (GNU as syntax, System V ABI)
+// for prog, defining main.  Link the result with the runtime in pl0rt.c;
+// the program means the same as the bytecode for it (see gen_code.h).
+extern void gen_asm_program(FILE *out, AST *prog);
+
+#endif
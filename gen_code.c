@@ -0,0 +1,139 @@
+// Generation of bytecode (see code.h) from checked ASTs
+#include <stdlib.h>
+#include "utilities.h"
+#include "gen_code.h"
+
+static void gen_code_stmt(code_seq *cs, AST *stmt);
+static void gen_code_cond(code_seq *cs, AST *cond);
+static void gen_code_expr(code_seq *cs, AST *exp);
+
+// Return the number of elements in the AST list lst
+static unsigned int gen_code_list_length(AST_list lst)
+{
+    unsigned int n = 0;
+    while (!ast_list_is_empty(lst)) {
+	n++;
+	lst = ast_list_rest(lst);
+    }
+    return n;
+}
+
+// Return the bytecode for prog, which ends by halting the machine.
+// Each declaration has a variable in the frame (at its offset),
+// and the constants' variables are initialized first.
+code_seq *gen_code_program(AST *prog)
+{
+    AST_list cds = prog->data.program.cds;
+    unsigned int frame_size = gen_code_list_length(cds)
+	+ gen_code_list_length(prog->data.program.vds);
+    code_seq *cs = code_seq_create(frame_size);
+    while (!ast_list_is_empty(cds)) {
+	AST *cd = ast_list_first(cds);
+	code_emit(cs, op_lit, cd->data.const_decl.num_val);
+	code_emit(cs, op_sto, cd->data.const_decl.offset);
+	cds = ast_list_rest(cds);
+    }
+    gen_code_stmt(cs, prog->data.program.stmt);
+    code_emit(cs, op_hlt, 0);
+    return cs;
+}
+
+// Generate code for the statement stmt into cs
+static void gen_code_stmt(code_seq *cs, AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	gen_code_expr(cs, stmt->data.assign_stmt.exp);
+	code_emit(cs, op_sto, stmt->data.assign_stmt.offset);
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    gen_code_stmt(cs, ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast: {
+	gen_code_cond(cs, stmt->data.if_stmt.cond);
+	uint32_t jump_to_else = code_emit(cs, op_jpc, 0);
+	gen_code_stmt(cs, stmt->data.if_stmt.thenstmt);
+	uint32_t jump_to_end = code_emit(cs, op_jmp, 0);
+	code_patch(cs, jump_to_else, cs->count);
+	gen_code_stmt(cs, stmt->data.if_stmt.elsestmt);
+	code_patch(cs, jump_to_end, cs->count);
+	break;
+    }
+    case while_ast: {
+	uint32_t start = cs->count;
+	gen_code_cond(cs, stmt->data.while_stmt.cond);
+	uint32_t jump_to_end = code_emit(cs, op_jpc, 0);
+	gen_code_stmt(cs, stmt->data.while_stmt.stmt);
+	code_emit(cs, op_jmp, start);
+	code_patch(cs, jump_to_end, cs->count);
+	break;
+    }
+    case read_ast:
+	code_emit(cs, op_rch, 0);
+	code_emit(cs, op_sto, stmt->data.read_stmt.offset);
+	break;
+    case write_ast:
+	gen_code_expr(cs, stmt->data.write_stmt.exp);
+	code_emit(cs, op_wch, 0);
+	break;
+    case skip_ast:
+	break;
+    default:
+	bail_with_error("Call to gen_code_stmt with an AST that is not a statement!");
+	break;
+    }
+}
+
+// Generate code for the condition cond into cs,
+// which leaves 1 (true) or 0 (false) on the stack
+static void gen_code_cond(code_seq *cs, AST *cond)
+{
+    switch (cond->type_tag) {
+    case odd_cond_ast:
+	gen_code_expr(cs, cond->data.odd_cond.exp);
+	code_emit(cs, op_odd, 0);
+	break;
+    case bin_cond_ast: {
+	static const op_code rel_ops[] =
+	    {op_eql, op_neq, op_lss, op_leq, op_gtr, op_geq};
+	gen_code_expr(cs, cond->data.bin_cond.leftexp);
+	gen_code_expr(cs, cond->data.bin_cond.rightexp);
+	code_emit(cs, rel_ops[cond->data.bin_cond.relop], 0);
+	break;
+    }
+    default:
+	bail_with_error("Unexpected type_tag %d in gen_code_cond!",
+			cond->type_tag);
+	break;
+    }
+}
+
+// Generate code for the expression exp into cs,
+// which leaves its value on the stack
+static void gen_code_expr(code_seq *cs, AST *exp)
+{
+    switch (exp->type_tag) {
+    case bin_expr_ast: {
+	static const op_code arith_ops[] = {op_add, op_sub, op_mul, op_div};
+	gen_code_expr(cs, exp->data.bin_expr.leftexp);
+	gen_code_expr(cs, exp->data.bin_expr.rightexp);
+	code_emit(cs, arith_ops[exp->data.bin_expr.arith_op], 0);
+	break;
+    }
+    case ident_ast:
+	code_emit(cs, op_lod, exp->data.ident.offset);
+	break;
+    case number_ast:
+	code_emit(cs, op_lit, exp->data.number.value);
+	break;
+    default:
+	bail_with_error("Unexpected type_tag %d in gen_code_expr!",
+			exp->type_tag);
+	break;
+    }
+}
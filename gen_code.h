@@ -0,0 +1,13 @@
+#ifndef _GEN_CODE_H
+#define _GEN_CODE_H
+#include "ast.h"
+#include "code.h"
+
+// Requires: prog is a program AST that has been scope checked
+// (so the offsets of names in it are filled in)
+// Return the bytecode for prog, which ends by halting the machine.
+// A write statement writes its value as a character,
+// and a read statement reads a character (or -1 at EOF).
+extern code_seq *gen_code_program(AST *prog);
+
+#endif
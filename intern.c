@@ -0,0 +1,127 @@
+// Interning of identifier (and other token) spellings
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utilities.h"
+#include "arena.h"
+#include "intern.h"
+#include "stats.h"
+
+// Initial number of slots in the hash table (a power of 2)
+#define INTERN_INITIAL_CAPACITY 1024
+
+// Size of the chunks used to hold the interned strings
+#define INTERN_CHUNK_SIZE (64*1024)
+
+// A slot in the hash table; str == NULL for an empty slot
+typedef struct {
+    const char *str;
+    uint32_t hash;
+    uint32_t len;
+} intern_entry;
+
+// The open-addressing (linear probing) hash table
+static _Thread_local intern_entry *table = NULL;
+// Number of slots in table (a power of 2)
+static _Thread_local size_t capacity = 0;
+// Number of slots in use
+static _Thread_local size_t count = 0;
+// Storage for the interned strings themselves
+static _Thread_local arena *strings = NULL;
+
+// Return the (32 bit FNV-1a) hash of the first len chars of s
+static uint32_t intern_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+	h ^= (unsigned char) s[i];
+	h *= 16777619u;
+    }
+    return h;
+}
+
+// Allocate a table with cap (empty) slots
+static intern_entry *intern_table_alloc(size_t cap)
+{
+    intern_entry *ret = (intern_entry *) calloc(cap, sizeof(intern_entry));
+    stats_count_alloc(stats_lexer_text, cap * sizeof(intern_entry));
+    if (ret == NULL) {
+	bail_with_error("No space for string table!");
+    }
+    return ret;
+}
+
+// Initialize the table, if that has not been done yet
+static void intern_initialize()
+{
+    if (table == NULL) {
+	capacity = INTERN_INITIAL_CAPACITY;
+	table = intern_table_alloc(capacity);
+	count = 0;
+	strings = arena_create(INTERN_CHUNK_SIZE);
+    }
+}
+
+// Double the size of the table, rehashing all entries
+static void intern_grow()
+{
+    size_t new_cap = 2 * capacity;
+    intern_entry *new_table = intern_table_alloc(new_cap);
+    for (size_t i = 0; i < capacity; i++) {
+	if (table[i].str != NULL) {
+	    size_t j = table[i].hash & (new_cap - 1);
+	    while (new_table[j].str != NULL) {
+		j = (j + 1) & (new_cap - 1);
+	    }
+	    new_table[j] = table[i];
+	}
+    }
+    free(table);
+    table = new_table;
+    capacity = new_cap;
+}
+
+// Return the unique, null-terminated interned copy of
+// the first len chars of s (adding it to the table if necessary).
+const char *intern_string(const char *s, size_t len)
+{
+    intern_initialize();
+    uint32_t h = intern_hash(s, len);
+    size_t i = h & (capacity - 1);
+    while (table[i].str != NULL) {
+	if (table[i].hash == h && table[i].len == len
+	    && memcmp(table[i].str, s, len) == 0) {
+	    return table[i].str;
+	}
+	i = (i + 1) & (capacity - 1);
+    }
+    // not found, so add it to the empty slot i
+    const char *str = arena_strndup(strings, s, len);
+    stats_count_alloc(stats_lexer_text, len + 1);
+    table[i].str = str;
+    table[i].hash = h;
+    table[i].len = (uint32_t) len;
+    count++;
+    // keep the load factor at most 1/2
+    if (2 * count > capacity) {
+	intern_grow();
+    }
+    return str;
+}
+
+// Return the number of distinct strings interned so far
+unsigned int intern_count()
+{
+    return (unsigned int) count;
+}
+
+// Forget all interned strings, giving back their storage
+void intern_reset()
+{
+    if (table == NULL) {
+	return;
+    }
+    memset(table, 0, capacity * sizeof(intern_entry));
+    count = 0;
+    arena_release(strings);
+}
@@ -0,0 +1,29 @@
+#ifndef _INTERN_H
+#define _INTERN_H
+#include <stddef.h>
+#include <stdbool.h>
+
+// String interning: every distinct spelling is stored exactly once,
+// so two interned strings are equal just when they are the same pointer.
+
+// Requires: s has at least len chars
+// Return the unique, null-terminated interned copy of
+// the first len chars of s (adding it to the table if necessary).
+// The result lives until the next call to intern_reset.
+extern const char *intern_string(const char *s, size_t len);
+
+// Return the number of distinct strings interned so far
+extern unsigned int intern_count();
+
+// Forget all interned strings, giving back their storage,
+// so all pointers returned by intern_string become invalid
+extern void intern_reset();
+
+// Requires: s1 and s2 were both returned by intern_string
+// Are s1 and s2 the same string?
+static inline bool intern_equal(const char *s1, const char *s2)
+{
+    return s1 == s2;
+}
+
+#endif
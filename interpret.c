@@ -0,0 +1,159 @@
+// A tree-walking interpreter for checked program ASTs
+#include <stdio.h>
+#include <stdlib.h>
+#include "utilities.h"
+#include "interpret.h"
+
+// The values of the program's constants and variables,
+// indexed by the offsets of their declarations
+static _Thread_local short *frame = NULL;
+// Where write statements write
+static _Thread_local FILE *prog_out;
+
+static void interpret_stmt(AST *stmt);
+static bool interpret_cond(AST *cond);
+static short interpret_expr(AST *exp);
+
+// Run prog by walking its AST, writing its output to out
+void interpret_program(FILE *out, AST *prog)
+{
+    prog_out = out;
+    unsigned int frame_size = 0;
+    AST_list l;
+    for (l = prog->data.program.cds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	frame_size++;
+    }
+    for (l = prog->data.program.vds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	frame_size++;
+    }
+    // a previous program's frame is left when it stopped with an error
+    free(frame);
+    frame = (short *) calloc(frame_size + 1, sizeof(short));
+    if (frame == NULL) {
+	bail_with_error("No space for the program's variables!");
+    }
+    for (l = prog->data.program.cds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	AST *cd = ast_list_first(l);
+	frame[cd->data.const_decl.offset] = cd->data.const_decl.num_val;
+    }
+    interpret_stmt(prog->data.program.stmt);
+    fflush(prog_out);
+    free(frame);
+    frame = NULL;
+}
+
+// Execute the statement stmt
+static void interpret_stmt(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	frame[stmt->data.assign_stmt.offset]
+	    = interpret_expr(stmt->data.assign_stmt.exp);
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    interpret_stmt(ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast:
+	if (interpret_cond(stmt->data.if_stmt.cond)) {
+	    interpret_stmt(stmt->data.if_stmt.thenstmt);
+	} else {
+	    interpret_stmt(stmt->data.if_stmt.elsestmt);
+	}
+	break;
+    case while_ast:
+	while (interpret_cond(stmt->data.while_stmt.cond)) {
+	    interpret_stmt(stmt->data.while_stmt.stmt);
+	}
+	break;
+    case read_ast:
+	frame[stmt->data.read_stmt.offset] = (short) getchar();
+	break;
+    case write_ast:
+	fputc(interpret_expr(stmt->data.write_stmt.exp), prog_out);
+	break;
+    case skip_ast:
+	break;
+    default:
+	bail_with_error("Call to interpret_stmt with an AST that is not a statement!");
+	break;
+    }
+}
+
+// Return the value of the condition cond
+static bool interpret_cond(AST *cond)
+{
+    switch (cond->type_tag) {
+    case odd_cond_ast:
+	return interpret_expr(cond->data.odd_cond.exp) % 2 != 0;
+    case bin_cond_ast: {
+	short left = interpret_expr(cond->data.bin_cond.leftexp);
+	short right = interpret_expr(cond->data.bin_cond.rightexp);
+	switch (cond->data.bin_cond.relop) {
+	case eqop:
+	    return left == right;
+	case neqop:
+	    return left != right;
+	case ltop:
+	    return left < right;
+	case leqop:
+	    return left <= right;
+	case gtop:
+	    return left > right;
+	case geqop:
+	    return left >= right;
+	default:
+	    bail_with_error("Unknown rel_op %d", cond->data.bin_cond.relop);
+	    break;
+	}
+	break;
+    }
+    default:
+	bail_with_error("Unexpected type_tag %d in interpret_cond!",
+			cond->type_tag);
+	break;
+    }
+    return false;
+}
+
+// Return the value of the expression exp
+static short interpret_expr(AST *exp)
+{
+    switch (exp->type_tag) {
+    case bin_expr_ast: {
+	short left = interpret_expr(exp->data.bin_expr.leftexp);
+	short right = interpret_expr(exp->data.bin_expr.rightexp);
+	switch (exp->data.bin_expr.arith_op) {
+	case addop:
+	    return (short) (left + right);
+	case subop:
+	    return (short) (left - right);
+	case multop:
+	    return (short) (left * right);
+	case divop:
+	    if (right == 0) {
+		general_error(exp->file_loc, "division by zero");
+	    }
+	    return (short) (left / right);
+	default:
+	    bail_with_error("Unexpected bin_arith_op %d in interpret_expr",
+			    exp->data.bin_expr.arith_op);
+	    break;
+	}
+	break;
+    }
+    case ident_ast:
+	return frame[exp->data.ident.offset];
+    case number_ast:
+	return exp->data.number.value;
+    default:
+	bail_with_error("Unexpected type_tag %d in interpret_expr!",
+			exp->type_tag);
+	break;
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+#ifndef _INTERPRET_H
+#define _INTERPRET_H
+#include <stdio.h>
+#include "ast.h"
+
+// Requires: prog is a program AST that has been scope checked
+// (so the offsets of names in it are filled in) and out is open for writing
+// Run prog by walking its AST, with the same meaning as the
+// code generated for it (see gen_code.h): variables live in a frame
+// indexed by their offsets, values are shorts (so arithmetic wraps),
+// write writes a character to out and read reads one from stdin
+// (or -1 at EOF).  Division by zero is reported as an error.
+extern void interpret_program(FILE *out, AST *prog);
+
+#endif
@@ -1,414 +1,667 @@
-/* $Id: lexer.c,v 1.10 2023/02/24 17:12:16 leavens Exp leavens $ */
-#include <stdio.h>
-#include <stdlib.h>
-#include <assert.h>
-#include <ctype.h>
-#include <limits.h>
-#include "token.h"
-#include "utilities.h"
-#include "lexer.h"
-#include "reserved.h"
-
-// The input file
-static FILE *input_file = NULL;
-// The input file's name
-static const char *filename = NULL;
-// Is this token stream done (past EOF or error)?
-static bool done = true;
-// the line of the next token
-static unsigned int line;
-// the column of the next token
-static unsigned int column;
-
-// Check the lexer's invariant
-static void lexer_okay()
-{
-    assert(done == (input_file == NULL));
-    assert(done == (filename == NULL));
-}
-
-// Initialize the lexer (i.e., its data structures)
-static void lexer_initialize()
-{
-    filename = NULL;
-    input_file = NULL;
-    done = true;
-    line = 1;
-    column = 1;
-    reserved_initialize();
-}
-
-// Requires: fname != NULL
-// Requires: fname is the name of a readable file
-// Initialize the lexer and start it reading
-// from the given file name
-void lexer_open(const char *fname)
-{
-    lexer_initialize();
-    input_file = fopen(fname, "r");
-    if (input_file == NULL) {
-	bail_with_error("Cannot open %s", fname);
-    }
-    filename = fname;
-    done = feof(input_file);
-    if (done) {
-	input_file = NULL;
-	filename = NULL;
-    }
-    lexer_okay();
-}
-
-// Close the file the lexer is working on
-// and make this lexer be done
-void lexer_close()
-{
-    lexer_okay();
-    if (input_file != NULL) {
-	int rc = fclose(input_file);
-	if (rc == EOF) {
-	    bail_with_error("Cannot close %s!", filename);
-	}
-    }
-    input_file = NULL;
-    filename = NULL;
-    done = true;
-    lexer_okay();
-}
-
-// Is the lexer's token stream finished
-// (either past EOF or not open)?
-bool lexer_done()
-{
-    return done;
-}
-
-// the previous value of column,
-// for use in lexer_ungetchar
-static unsigned int last_column = 0;
-
-// Requires: input_file is readable
-// Return the next char in the input
-// updating line and column as appropriate
-// update last_column to the old value of column
-static char lexer_getchar()
-{
-    char c = getc(input_file);
-    last_column = column;
-    if (c == '\n') {
-	line++;
-	column=1;
-    } else {
-	column++;
-    }
-    return c;
-}
-
-// Requires: input_file is readable
-// Put c back into the input file stream
-// to be read again
-static void lexer_ungetchar(char c)
-{
-    column = last_column;
-    if (c == '\n') {
-	line--;
-    }
-    if (c != EOF) {
-	ungetc(c, input_file);
-    }
-}
-
-// forward declarations of lexical functions
-static void lexer_consume_ignored();
-static token lexer_ident(char c, token t);
-static token lexer_number(char c, token t);
-static token lexer_becomes(char c, token t);
-static token lexer_starts_less(char c, token t);
-static token lexer_starts_greater(char c, token t);
-
-// Requires: !lexer_done()
-// Return the next token in the input file,
-// advancing in the input
-token lexer_next()
-{
-    token t;
-    t.filename = filename;
-    t.typ = eofsym;
-    t.text = NULL;
-    t.value = 0;
-
-    lexer_consume_ignored();
-
-    t.line = line;
-    t.column = column;
-
-    char c = lexer_getchar(input_file);
-    
-    // since we consumed all the whitespace
-    // c should not be a kind of space character
-    assert(!isspace(c));
-    
-    if (c == EOF) {
-	t.typ = eofsym;
-	t.text = NULL;
-	filename = NULL;
-	input_file = NULL;
-	done = true;
-	return t;
-    }
-    if (isalpha(c)) {
-	return lexer_ident(c, t);
-    } else if (isdigit(c)) {
-	return lexer_number(c, t);
-    } else {
-	// leave room in t.text for 2 chars of text
-	t.text = malloc(3 * sizeof(char));
-	if (t.text == NULL) {
-	    bail_with_error("Cannot allocate space for token text!");
-	}
-	t.text[0] = c;
-	t.text[1] = '\0';
-	switch (c) {
-	case '.':
-	    t.typ = periodsym;
-	    break;
-	case ';':
-	    t.typ = semisym;
-	    break;
-	case ',':
-	    t.typ = commasym;
-	    break;
-	case ':':
-	    return lexer_becomes(c, t);
-	case '=':
-	    t.typ = eqsym;
-	    break;
-	case '(':
-	    t.typ = lparensym;
-	    break;
-	case ')':
-	    t.typ = rparensym;
-	    break;
-	case '<':
-	    return lexer_starts_less(c, t);
-	    break;
-	case '>':
-	    return lexer_starts_greater(c, t);
-	    break;
-	case '+':
-	    t.typ = plussym;
-	    break;
-	case '-':
-	    t.typ = minussym;
-	    break;
-	case '*':
-	    t.typ = multsym;
-	    break;
-	case '/':
-	    t.typ = divsym;
-	    break;
-	default:
-	    lexical_error(filename, line, column-1,
-			  "Illegal character '%c' (0%o)",
-			   c, c);
-	    break;
-	}
-	return t;
-    }
-}
-
-// Requires: !lexer_done()
-// Return the name of the current file
-const char *lexer_filename()
-{
-    if (lexer_done()) {
-	bail_with_error("Asking for file name of done lexer!");
-    }
-    return filename;
-}
-
-// Requires: !lexer_done()
-// Return the line number of the next token
-unsigned int lexer_line()
-{
-    if (lexer_done()) {
-	bail_with_error("Asking for line of done lexer!");
-    }
-    return line;
-}
-
-// Requires: !lexer_done()
-// Return the column number of the next token
-unsigned int lexer_column()
-{
-    if (lexer_done()) {
-	bail_with_error("Asking for column of done lexer!");
-    }
-    return column;
-}
-
-// Requires: input_file is readable
-// Advance input_file to the next newline
-static void lexer_consume_comment()
-{
-    char c = lexer_getchar();
-    while (c != '\n' && c != EOF) {
-	c = lexer_getchar();
-    }
-    if (c == EOF) {
-	lexical_error(filename, line, column-1,
-		      "File ended while reading comment!");
-    }
-    // assert(c == '\n');
-}
-
-// Requires: input_file is readable
-// Advance in the input file until
-// the next char is the start of a token
-// that is not ignored
-// (i.e., not whitespace or a comment)
-static void lexer_consume_ignored()
-{
-    char c = lexer_getchar();
-    while (isspace(c) || c == '#') {
-	if (isspace(c)) {
-	    // ignore the whitespace char
-	    c = lexer_getchar();
-	} else if (c == '#') {
-	    lexer_consume_comment();
-	    c = lexer_getchar();
-	}
-    }
-    // assert(!isspace(c) && c != '#');
-    lexer_ungetchar(c);
-}
-
-// Requires: c is a letter
-// Return a token for a reserved word
-// or an identifier
-static token lexer_ident(char c, token t)
-{
-    char *text = malloc((MAX_IDENT_LENGTH+1)*sizeof(char));
-    if (text == NULL) {
-	bail_with_error("Cannot allocate space for identifier");
-    }
-    text[0] = c;
-    int n = 1;
-    c = lexer_getchar();
-    while (isalpha(c) || isdigit(c)) {
-	if (n >= MAX_IDENT_LENGTH) {
-	    text[n] = '\0';
-	    lexical_error(filename, t.line, t.column,
-			  "Identifier starting \"%s\" is too long!",
-			  text);
-	}
-	text[n] = c;
-	n++;
-	c = lexer_getchar();
-    }
-    // assert(!isalpha(c) && !isdigit(c));
-    text[n+1] = '\0';    
-    lexer_ungetchar(c);
-    t.text = text;
-    t.typ = reserved_type(text);
-    return t;
-}
-
-#define MAX_NUM_LENGTH 5
-
-// Requires: c is a digit
-// Return a token for a number
-static token lexer_number(char c, token t)
-{
-    char *text = malloc((MAX_NUM_LENGTH+1)*sizeof(char));
-    if (text == NULL) {
-	bail_with_error("Cannot allocate space for number");
-    }
-    text[0] = c;
-    int n = 1;
-    c = lexer_getchar();
-    while (isdigit(c)) {
-	if (n >= MAX_NUM_LENGTH) {
-	    text[n] = '\0';
-	    bail_with_error(filename, t.line, t.column,
-			    "Number starting \"%s\" is too long!",
-			    text);
-	}
-	text[n] = c;
-	n++;
-	c = lexer_getchar();
-    }
-    text[n+1] = '\0';
-    lexer_ungetchar(c);
-    t.text = text;
-    int val;
-    sscanf(text, "%d", &val);
-    if (val > SHRT_MAX) {
-	lexical_error(filename, t.line, t.column,
-		      "The value of %s is too large for a short!",
-		      text);
-    }
-    t.value = val;
-    t.typ = numbersym;
-    return t;
-}
-
-// Requires: c is a colon character (:)
-// Returns the token for a becomessym
-static token lexer_becomes(char c, token t)
-{
-    assert(c == ':');
-    c = lexer_getchar();
-    if (c != '=') {
-	lexical_error(filename, line, column-1,
-		      "Expecting '=' after a colon, not '%c'",
-		      c);
-    }
-    t.text[1] = c;
-    t.text[2] = '\0';
-    t.typ = becomessym;
-    return t;
-}
-
-// Requires: c is a less-than character (<)
-// Returns the token appropriate for the next char
-static token lexer_starts_less(char c, token t)
-{
-    assert(c == '<');
-    c = lexer_getchar();
-    t.text[1] = c;
-    t.text[2] = '\0';
-    switch (c) {
-    case '=':
-	t.typ = leqsym;
-	break;
-    case '>':
-	t.typ = neqsym;
-	break;
-    default:
-	t.text[1] = '\0';
-	lexer_ungetchar(c);
-	t.typ = lessym;
-	break;
-    }
-    return t;
-}
-
-static token lexer_starts_greater(char c, token t)
-{
-    assert(c == '>');
-    c = lexer_getchar();
-    t.text[1] = c;
-    t.text[2] = '\0';
-    switch (c) {
-    case '=':
-	t.typ = geqsym;
-	break;
-    default:
-	t.text[1] = '\0';
-	lexer_ungetchar(c);
-	t.typ = gtrsym;
-	break;
-    }
-    return t;
-
-}
+/* $Id: lexer.c,v 1.10 2023/02/24 17:12:16 leavens Exp leavens $ */
+// for mmap and fstat
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "token.h"
+#include "utilities.h"
+#include "lexer.h"
+#include "reserved.h"
+#include "intern.h"
+#include "file_location.h"
+#include "stats.h"
+#include "tokstream.h"
+
+// The whole contents of the input file, which is mapped into memory
+// (or, for pipes and other files that cannot be mapped, read into
+// a malloc-ed buffer), or NULL if there is no input.
+// It is kept after the lexer is done, as the tokens' file locations
+// refer to it, until lexer_release() is called or another file is opened.
+static _Thread_local const char *input_buf = NULL;
+// The number of bytes mapped at input_buf (0 if nothing was mapped)
+static _Thread_local size_t input_mapped_len = 0;
+// Was input_buf malloc-ed (rather than mapped)?
+static _Thread_local bool input_malloced = false;
+// The next char to read from input_buf and the end of input_buf
+static _Thread_local const char *input_pos = NULL;
+static _Thread_local const char *input_end = NULL;
+// The address that the file offset 0 of the input would have
+// (input_buf, unless the input starts partway into a file,
+// see lexer_open_text), so the offset of the char at p is p - input_origin
+static _Thread_local uintptr_t input_origin = 0;
+// Did the lexer record the input's file (see file_location.h) itself?
+static _Thread_local bool input_recorded = false;
+// The input file's name
+static _Thread_local const char *filename = NULL;
+// The reader of the input, when it is a token stream
+// (see tokstream.h) rather than a program's text, otherwise NULL
+static _Thread_local tokstream_reader *reader = NULL;
+// The input file's id, for file locations (see file_location.h)
+static _Thread_local unsigned int file_id = 0;
+// Is this token stream done (past EOF or error)?
+static _Thread_local bool done = true;
+
+// The classes of chars the lexer cares about, as in the "C" locale
+// (so only ASCII chars are spaces, letters, or digits)
+#define CC_SPACE 1
+#define CC_ALPHA 2
+#define CC_DIGIT 4
+
+// The class of each char (as an unsigned char, so EOF's is 0)
+static const unsigned char char_classes[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, CC_SPACE, CC_SPACE, CC_SPACE, CC_SPACE, CC_SPACE, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    CC_SPACE, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0,
+    CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT, CC_DIGIT,
+    CC_DIGIT, CC_DIGIT, 0, 0, 0, 0, 0, 0,
+    0, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, 0, 0, 0, 0, 0,
+    0, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA, CC_ALPHA,
+    CC_ALPHA, CC_ALPHA, CC_ALPHA, 0, 0, 0, 0, 0,
+    // the rest (chars >= 128) are 0
+};
+
+// Does c have any of the classes in the given bit set?
+#define char_is(c, classes) ((char_classes[(unsigned char) (c)] & (classes)) != 0)
+#define is_space(c) char_is(c, CC_SPACE)
+#define is_alpha(c) char_is(c, CC_ALPHA)
+#define is_digit(c) char_is(c, CC_DIGIT)
+#define is_alnum(c) char_is(c, CC_ALPHA | CC_DIGIT)
+
+// Check the lexer's invariant
+static void lexer_okay()
+{
+    assert(done == (filename == NULL));
+    assert(done || input_buf != NULL);
+}
+
+// Initialize the lexer (i.e., its data structures)
+static void lexer_initialize()
+{
+    filename = NULL;
+    input_buf = NULL;
+    input_mapped_len = 0;
+    input_malloced = false;
+    input_pos = NULL;
+    input_end = NULL;
+    input_origin = 0;
+    input_recorded = false;
+    done = true;
+    reserved_initialize();
+}
+
+// Requires: fd is open for reading
+// Read all of fd (a pipe, terminal, ...) into a malloc-ed input_buf,
+// returning false if that fails
+static bool lexer_read_input(int fd)
+{
+    size_t cap = BUFSIZ, len = 0;
+    char *buf = (char *) malloc(cap);
+    for (;;) {
+	if (buf == NULL) {
+	    return false;
+	}
+	ssize_t n = read(fd, buf + len, cap - len);
+	if (n < 0) {
+	    free(buf);
+	    return false;
+	} else if (n == 0) {
+	    break;
+	}
+	len += (size_t) n;
+	if (len == cap) {
+	    cap *= 2;
+	    char *bigger = (char *) realloc(buf, cap);
+	    if (bigger == NULL) {
+		free(buf);
+	    }
+	    buf = bigger;
+	}
+    }
+    input_buf = buf;
+    input_malloced = true;
+    input_pos = input_buf;
+    input_end = input_buf + len;
+    return true;
+}
+
+// Requires: fd is open for reading
+// Set up the input from fd: regular files are mapped into memory,
+// anything else (pipes, terminals, ...) is read into memory,
+// and fd is closed.  Returns false if the input could not be set up.
+static bool lexer_setup_input(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+	bool ok = lexer_read_input(fd);
+	close(fd);
+	return ok;
+    }
+    size_t len = (size_t) st.st_size;
+    if (len == 0) {
+	// mmap cannot map an empty file, but there is nothing to read
+	input_buf = "";
+    } else {
+	void *m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m == MAP_FAILED) {
+	    close(fd);
+	    return false;
+	}
+	input_buf = (const char *) m;
+	input_mapped_len = len;
+    }
+    close(fd);
+    input_pos = input_buf;
+    input_end = input_buf + len;
+    return true;
+}
+
+// Release the input (unmapping or freeing it),
+// and forget the file locations in it (if the lexer recorded its file)
+static void lexer_release_input()
+{
+    if (reader != NULL) {
+	tokstream_close(reader);
+	reader = NULL;
+    }
+    if (input_mapped_len > 0) {
+	munmap((void *) input_buf, input_mapped_len);
+    } else if (input_malloced) {
+	free((void *) input_buf);
+    }
+    if (input_recorded) {
+	file_location_clear_files();
+    }
+    input_buf = NULL;
+    input_mapped_len = 0;
+    input_malloced = false;
+    input_pos = NULL;
+    input_end = NULL;
+    input_origin = 0;
+    input_recorded = false;
+}
+
+// Requires: fname != NULL
+// Requires: fname is the name of a readable file
+// Initialize the lexer and start it reading
+// from the given file name
+// (which may hold a token stream, see tokstream.h,
+// whose tokens are then read instead of lexed)
+void lexer_open(const char *fname)
+{
+    // give back the input of a file that was not finished (after an error)
+    lexer_release_input();
+    lexer_initialize();
+    int fd = open(fname, O_RDONLY);
+    if (fd < 0 || !lexer_setup_input(fd)) {
+	bail_with_error("Cannot open %s", fname);
+    }
+    if (input_end - input_buf > UINT_MAX) {
+	bail_with_error("File %s is too large!", fname);
+    }
+    if (tokstream_is_stream(input_buf, input_end - input_buf)) {
+	// the tokens have been lexed already, so just read them
+	reader = tokstream_open(input_buf, input_end - input_buf, fname);
+	filename = tokstream_source_name(reader);
+    } else {
+	file_id = file_location_add_file(fname, input_buf,
+					 input_end - input_buf);
+	filename = fname;
+    }
+    input_origin = (uintptr_t) input_buf;
+    input_recorded = true;
+    done = false;
+    lexer_okay();
+}
+
+// Requires: fname != NULL, file is the id of the (recorded) file
+//           named fname, and the len chars at text are its contents
+//           from offset on, which stay valid while they are lexed
+// Initialize the lexer and start it reading the len chars at text
+// (the tokens' offsets are then from the start of the file)
+void lexer_open_text(const char *fname, unsigned int file,
+		     const char *text, size_t len, unsigned int offset)
+{
+    lexer_release_input();
+    lexer_initialize();
+    input_buf = text;
+    input_pos = text;
+    input_end = text + len;
+    input_origin = (uintptr_t) text - offset;
+    file_id = file;
+    filename = fname;
+    done = false;
+    lexer_okay();
+}
+
+// Close the file the lexer is working on
+// and make this lexer be done
+// (its input is kept until lexer_release())
+void lexer_close()
+{
+    lexer_okay();
+    filename = NULL;
+    done = true;
+    lexer_okay();
+}
+
+// Give back the input of the last file the lexer read,
+// after which the lines and columns of its tokens' file locations
+// can no longer be found
+void lexer_release()
+{
+    lexer_release_input();
+}
+
+// Is the lexer's token stream finished
+// (either past EOF or not open)?
+bool lexer_done()
+{
+    return done;
+}
+
+// Requires: the input is readable
+// Return the next char in the input (EOF at its end)
+static inline char lexer_getchar()
+{
+    return (input_pos < input_end) ? *input_pos++ : EOF;
+}
+
+// Requires: the input is readable
+// Put c back into the input
+// to be read again
+static inline void lexer_ungetchar(char c)
+{
+    if (c != EOF) {
+	input_pos--;
+    }
+}
+
+// Return the file location of the char at p in the input
+static file_location lexer_location(const char *p)
+{
+    file_location ret;
+    ret.file = file_id;
+    ret.offset = (unsigned int) ((uintptr_t) p - input_origin);
+    return ret;
+}
+
+// forward declarations of lexical functions
+static void lexer_consume_ignored();
+static token lexer_ident(char c, token t);
+static token lexer_number(char c, token t);
+static token lexer_becomes(char c, token t);
+static token lexer_starts_less(char c, token t);
+static token lexer_starts_greater(char c, token t);
+
+// Requires: !lexer_done()
+// Return the next token in the input file,
+// advancing in the input
+// (always inlined into lexer_next, as otherwise the extra call
+// and copy of the token slow lexing down by about a quarter)
+static inline __attribute__((always_inline)) token lexer_scan()
+{
+    token t;
+    t.file = file_id;
+    t.typ = eofsym;
+    t.text = NULL;
+    t.value = 0;
+
+    lexer_consume_ignored();
+
+    t.offset = (unsigned int) ((uintptr_t) input_pos - input_origin);
+
+    char c = lexer_getchar();
+    
+    // since we consumed all the whitespace
+    // c should not be a kind of space character
+    assert(!is_space(c));
+    
+    if (c == EOF) {
+	t.typ = eofsym;
+	t.text = NULL;
+	filename = NULL;
+	done = true;
+	return t;
+    }
+    if (is_alpha(c)) {
+	return lexer_ident(c, t);
+    } else if (is_digit(c)) {
+	return lexer_number(c, t);
+    } else {
+	switch (c) {
+	case '.':
+	    t.typ = periodsym;
+	    break;
+	case ';':
+	    t.typ = semisym;
+	    break;
+	case ',':
+	    t.typ = commasym;
+	    break;
+	case ':':
+	    return lexer_becomes(c, t);
+	case '=':
+	    t.typ = eqsym;
+	    break;
+	case '(':
+	    t.typ = lparensym;
+	    break;
+	case ')':
+	    t.typ = rparensym;
+	    break;
+	case '<':
+	    return lexer_starts_less(c, t);
+	    break;
+	case '>':
+	    return lexer_starts_greater(c, t);
+	    break;
+	case '+':
+	    t.typ = plussym;
+	    break;
+	case '-':
+	    t.typ = minussym;
+	    break;
+	case '*':
+	    t.typ = multsym;
+	    break;
+	case '/':
+	    t.typ = divsym;
+	    break;
+	default:
+	    lexical_error(token2file_loc(t),
+			  "Illegal character '%c' (0%o)",
+			   c, c);
+	    break;
+	}
+	t.text = ttyp2text(t.typ);
+	return t;
+    }
+}
+
+// Requires: !lexer_done()
+// Return the next token in the input file,
+// advancing in the input
+token lexer_next()
+{
+    token t;
+    if (reader != NULL) {
+	t = tokstream_next(reader);
+	if (t.typ == eofsym) {
+	    filename = NULL;
+	    done = true;
+	}
+    } else {
+	t = lexer_scan();
+    }
+    unit_stats.tokens[t.typ]++;
+    return t;
+}
+
+// Requires: !lexer_done()
+// Return the name of the current file
+const char *lexer_filename()
+{
+    if (lexer_done()) {
+	bail_with_error("Asking for file name of done lexer!");
+    }
+    return filename;
+}
+
+// Requires: !lexer_done()
+// Return the line number of the next token
+unsigned int lexer_line()
+{
+    if (lexer_done()) {
+	bail_with_error("Asking for line of done lexer!");
+    }
+    if (reader != NULL) {
+	return tokstream_line(reader);
+    }
+    return file_location_line(lexer_location(input_pos));
+}
+
+// Requires: !lexer_done()
+// Return the column number of the next token
+unsigned int lexer_column()
+{
+    if (lexer_done()) {
+	bail_with_error("Asking for column of done lexer!");
+    }
+    if (reader != NULL) {
+	return tokstream_column(reader);
+    }
+    return file_location_column(lexer_location(input_pos));
+}
+
+// Requires: !lexer_done()
+// Return the text of the current file, setting *len to its length
+// and *file to its id (see file_location.h),
+// or return NULL if the lexer is reading a token stream
+// (or a text given to lexer_open_text)
+const char *lexer_source(size_t *len, unsigned int *file)
+{
+    if (lexer_done()) {
+	bail_with_error("Asking for source of done lexer!");
+    }
+    if (reader != NULL || !input_recorded) {
+	return NULL;
+    }
+    *len = (size_t) (input_end - input_buf);
+    *file = file_id;
+    return input_buf;
+}
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LEXER_BLOCK_SIZE 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LEXER_BLOCK_SIZE 16
+#endif
+
+#ifdef LEXER_BLOCK_SIZE
+// Requires: p has at least LEXER_BLOCK_SIZE chars
+// Return a bit mask of the whitespace chars in the block at p
+// (bit i for p[i])
+static inline uint32_t lexer_block_spaces(const char *p)
+{
+#if defined(__AVX2__)
+    __m256i v = _mm256_loadu_si256((const __m256i *) p);
+    // the whitespace chars are ' ' and '\t' through '\r' (9 to 13)
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(4)), t);
+    __m256i sp = _mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    return (uint32_t) _mm256_movemask_epi8(sp);
+#else
+    __m128i v = _mm_loadu_si128((const __m128i *) p);
+    // the whitespace chars are ' ' and '\t' through '\r' (9 to 13)
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(4)), t);
+    __m128i sp = _mm_or_si128(ctrl, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    return (uint32_t) _mm_movemask_epi8(sp);
+#endif
+}
+#endif
+
+// Requires: the input is readable
+// Advance input_pos past the whitespace at it
+static void lexer_skip_spaces()
+{
+    const char *p = input_pos;
+#ifdef LEXER_BLOCK_SIZE
+    // a block at a time
+    while (input_end - p >= LEXER_BLOCK_SIZE) {
+	uint32_t non_spaces = ~lexer_block_spaces(p);
+	if (non_spaces != 0 && __builtin_ctz(non_spaces) < LEXER_BLOCK_SIZE) {
+	    input_pos = p + __builtin_ctz(non_spaces);
+	    return;
+	}
+	p += LEXER_BLOCK_SIZE;
+    }
+#endif
+    // the rest, a char at a time
+    while (p < input_end && is_space(*p)) {
+	p++;
+    }
+    input_pos = p;
+}
+
+// Requires: the input is readable
+// Advance in the input until
+// the next char is the start of a token
+// that is not ignored
+// (i.e., not whitespace or a comment)
+static void lexer_consume_ignored()
+{
+    lexer_skip_spaces();
+    while (input_pos < input_end && *input_pos == '#') {
+	// memchr finds the end of the comment many chars at a time
+	const char *nl = memchr(input_pos, '\n', input_end - input_pos);
+	if (nl == NULL) {
+	    lexical_error(lexer_location(input_end),
+			  "File ended while reading comment!");
+	}
+	input_pos = nl + 1;
+	lexer_skip_spaces();
+    }
+}
+
+// Requires: c is a letter
+// Return a token for a reserved word
+// or an identifier (whose text is interned, see intern.h)
+static token lexer_ident(char c, token t)
+{
+    char text[MAX_IDENT_LENGTH+1];
+    text[0] = c;
+    int n = 1;
+    c = lexer_getchar();
+    while (is_alnum(c)) {
+	if (n >= MAX_IDENT_LENGTH) {
+	    text[n] = '\0';
+	    lexical_error(token2file_loc(t),
+			  "Identifier starting \"%s\" is too long!",
+			  text);
+	}
+	text[n] = c;
+	n++;
+	c = lexer_getchar();
+    }
+    // assert(!is_alnum(c));
+    text[n] = '\0';
+    lexer_ungetchar(c);
+    t.typ = reserved_type_len(text, n);
+    if (t.typ == identsym) {
+	t.text = intern_string(text, n);
+    } else {
+	t.text = ttyp2text(t.typ);
+    }
+    return t;
+}
+
+#define MAX_NUM_LENGTH 5
+
+// Requires: c is a digit
+// Return a token for a number
+static token lexer_number(char c, token t)
+{
+    char text[MAX_NUM_LENGTH+1];
+    text[0] = c;
+    int n = 1;
+    int val = c - '0';
+    c = lexer_getchar();
+    while (is_digit(c)) {
+	if (n >= MAX_NUM_LENGTH) {
+	    text[n] = '\0';
+	    lexical_error(token2file_loc(t),
+			  "Number starting \"%s\" is too long!",
+			  text);
+	}
+	text[n] = c;
+	n++;
+	val = 10 * val + (c - '0');
+	c = lexer_getchar();
+    }
+    text[n] = '\0';
+    lexer_ungetchar(c);
+    if (val > SHRT_MAX) {
+	lexical_error(token2file_loc(t),
+		      "The value of %s is too large for a short!",
+		      text);
+    }
+    t.text = intern_string(text, n);
+    t.value = val;
+    t.typ = numbersym;
+    return t;
+}
+
+// Requires: c is a colon character (:)
+// Returns the token for a becomessym
+static token lexer_becomes(char c, token t)
+{
+    assert(c == ':');
+    const char *p = input_pos;
+    c = lexer_getchar();
+    if (c != '=') {
+	lexical_error(lexer_location(p),
+		      "Expecting '=' after a colon, not '%c'",
+		      c);
+    }
+    t.typ = becomessym;
+    t.text = ttyp2text(t.typ);
+    return t;
+}
+
+// Requires: c is a less-than character (<)
+// Returns the token appropriate for the next char
+static token lexer_starts_less(char c, token t)
+{
+    assert(c == '<');
+    c = lexer_getchar();
+    switch (c) {
+    case '=':
+	t.typ = leqsym;
+	break;
+    case '>':
+	t.typ = neqsym;
+	break;
+    default:
+	lexer_ungetchar(c);
+	t.typ = lessym;
+	break;
+    }
+    t.text = ttyp2text(t.typ);
+    return t;
+}
+
+static token lexer_starts_greater(char c, token t)
+{
+    assert(c == '>');
+    c = lexer_getchar();
+    switch (c) {
+    case '=':
+	t.typ = geqsym;
+	break;
+    default:
+	lexer_ungetchar(c);
+	t.typ = gtrsym;
+	break;
+    }
+    t.text = ttyp2text(t.typ);
+    return t;
+}
@@ -1,37 +1,65 @@
-/* $Id: lexer.h,v 1.2 2023/01/31 06:45:02 leavens Exp $ */
-#ifndef _LEXER_H
-#define _LEXER_H
-#include <stdbool.h>
-#include "token.h"
-
-// Requires: fname != NULL
-// Requires: fname is the name of a readable file
-// Initialize the lexer and start it reading
-// from the given file name
-extern void lexer_open(const char *fname);
-
-// Close the file the lexer is working on
-// and make this lexer be done
-extern void lexer_close();
-
-// Is the lexer's token stream finished
-// (either at EOF or not open)?
-extern bool lexer_done();
-
-// Requires: !lexer_done()
-// Return the next token in the input file,
-// advancing in the input
-extern token lexer_next();
-
-// Requires: !lexer_done()
-// Return the name of the current file
-extern const char *lexer_filename();
-
-// Requires: !lexer_done()
-// Return the line number of the next token
-extern unsigned int lexer_line();
-
-// Requires: !lexer_done()
-// Return the column number of the next token
-extern unsigned int lexer_column();
-#endif
+/* $Id: lexer.h,v 1.2 2023/01/31 06:45:02 leavens Exp $ */
+#ifndef _LEXER_H
+#define _LEXER_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "token.h"
+
+// Requires: fname != NULL
+// Requires: fname is the name of a readable file
+// Initialize the lexer and start it reading
+// from the given file name
+// (which may hold a token stream, see tokstream.h,
+// whose tokens are then read instead of lexed)
+extern void lexer_open(const char *fname);
+
+// Requires: fname != NULL, file is the id of the (recorded) file
+//           named fname (see file_location.h), and the len chars
+//           at text are its contents from offset on,
+//           which stay valid while they are lexed
+// Initialize the lexer and start it reading the len chars at text,
+// giving its tokens offsets from the start of the file
+// (the file is not recorded again, nor forgotten by lexer_release())
+extern void lexer_open_text(const char *fname, unsigned int file,
+			    const char *text, size_t len,
+			    unsigned int offset);
+
+// Close the file the lexer is working on
+// and make this lexer be done
+extern void lexer_close();
+
+// Give back the input of the last file the lexer read,
+// after which the lines and columns of its tokens' file locations
+// can no longer be found
+extern void lexer_release();
+
+// Is the lexer's token stream finished
+// (either at EOF or not open)?
+extern bool lexer_done();
+
+// Requires: !lexer_done()
+// Return the next token in the input file,
+// advancing in the input
+extern token lexer_next();
+
+// Requires: !lexer_done()
+// Return the name of the current file
+extern const char *lexer_filename();
+
+// Requires: !lexer_done()
+// Return the line number of the next token
+// (or, when reading a token stream, of the last token)
+extern unsigned int lexer_line();
+
+// Requires: !lexer_done()
+// Return the column number of the next token
+// (or, when reading a token stream, of the last token)
+extern unsigned int lexer_column();
+
+// Requires: !lexer_done()
+// Return the text of the current file, setting *len to its length
+// and *file to its id (see file_location.h),
+// or return NULL if the lexer is reading a token stream
+// (or a text given to lexer_open_text)
+extern const char *lexer_source(size_t *len, unsigned int *file);
+#endif
@@ -1,40 +1,48 @@
-/* $Id: lexer_output.c,v 1.2 2023/01/31 06:45:02 leavens Exp $ */
-#include <stdio.h>
-#include <stdlib.h>
-#include "lexer.h"
-
-// Requires: lexer is not done
-// Print a message about the file name of the lexer's input
-// And print a heading for the lexer's output.
-// Both are printed on stdout.
-static void lexer_print_output_header()
-{
-    printf("Tokens from file %s\n", lexer_filename());
-    printf("Number Name       Line Column Text/Value\n");
-}
-
-// Print information about the token t to stdout
-// followed by a newline
-static void lexer_print_token(token t)
-{
-    printf("%-6d %-10s %-4d %-6d", t.typ, ttyp2str(t.typ),
-	   t.line, t.column);
-    if (t.typ == numbersym) {
-	printf(" %d\n", t.value);
-    } else {
-	if (t.text != NULL) {
-	    printf(" \"%s\"\n", t.text);
-	} else {
-	    printf("\n");
-	}
-    }
-}
-
-void lexer_output()
-{
-    lexer_print_output_header();
-    while (!lexer_done()) {
-	token t = lexer_next();
-	lexer_print_token(t);
-    }
-}
+/* $Id: lexer_output.c,v 1.2 2023/01/31 06:45:02 leavens Exp $ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "lexer.h"
+#include "file_location.h"
+#include "lexer_output.h"
+
+// Requires: lexer is not done
+// Print a message about the file name of the lexer's input
+// And print a heading for the lexer's output.
+// Both are printed on out.
+static void lexer_print_output_header(FILE *out)
+{
+    fprintf(out, "Tokens from file %s\n", lexer_filename());
+    fprintf(out, "Number Name       Line Column Text/Value\n");
+}
+
+// Print information about the token t to out
+// followed by a newline
+static void lexer_print_token(FILE *out, token t)
+{
+    file_location floc = token2file_loc(t);
+    fprintf(out, "%-6d %-10s %-4d %-6d", t.typ, ttyp2str(t.typ),
+	    file_location_line(floc), file_location_column(floc));
+    if (t.typ == numbersym) {
+	fprintf(out, " %d\n", t.value);
+    } else {
+	if (t.text != NULL) {
+	    fprintf(out, " \"%s\"\n", t.text);
+	} else {
+	    fprintf(out, "\n");
+	}
+    }
+}
+
+void lexer_output()
+{
+    lexer_output_to(stdout);
+}
+
+void lexer_output_to(FILE *out)
+{
+    lexer_print_output_header(out);
+    while (!lexer_done()) {
+	token t = lexer_next();
+	lexer_print_token(out, t);
+    }
+}
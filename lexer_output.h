@@ -1,10 +1,16 @@
-/* $Id: lexer_output.h,v 1.1 2023/01/31 02:26:31 leavens Exp $ */
-#ifndef _LEXER_OUTPUT_H
-#define _LEXER_OUTPUT_H
-#include "lexer.h"
-
-// Requires: the lexer is not done
-// Output to stdout a table
-// of all the tokens read from the lexer's input file
-extern void lexer_output();
-#endif
+/* $Id: lexer_output.h,v 1.1 2023/01/31 02:26:31 leavens Exp $ */
+#ifndef _LEXER_OUTPUT_H
+#define _LEXER_OUTPUT_H
+#include <stdio.h>
+#include "lexer.h"
+
+// Requires: the lexer is not done
+// Output to stdout a table
+// of all the tokens read from the lexer's input file
+extern void lexer_output();
+
+// Requires: the lexer is not done and out is open for writing
+// Output to out a table
+// of all the tokens read from the lexer's input file
+extern void lexer_output_to(FILE *out);
+#endif
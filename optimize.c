@@ -0,0 +1,684 @@
+// Optimization passes over checked program ASTs
+#include <stdlib.h>
+#include "utilities.h"
+#include "optimize.h"
+
+// The passes, in the order they are run
+static void fold_program(AST *prog);
+static void dead_code_program(AST *prog);
+
+static const struct {
+    const char *name;
+    void (*run)(AST *prog);
+} passes[] = {
+    {"constant folding", fold_program},
+    {"dead code elimination", dead_code_program},
+};
+
+#define NUM_PASSES (sizeof(passes) / sizeof(passes[0]))
+
+// Run each optimization pass over prog, reporting node counts on report
+void optimize_program(AST *prog, FILE *report)
+{
+    for (unsigned int i = 0; i < NUM_PASSES; i++) {
+	unsigned int before = 0;
+	if (report != NULL) {
+	    before = optimize_count_nodes(prog);
+	}
+	passes[i].run(prog);
+	if (report != NULL) {
+	    fprintf(report, "%s: %u nodes before, %u nodes after\n",
+		    passes[i].name, before, optimize_count_nodes(prog));
+	}
+    }
+}
+
+// Return the number of declarations in prog
+static unsigned int frame_size_of(AST *prog)
+{
+    unsigned int n = 0;
+    AST_list l;
+    for (l = prog->data.program.cds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	n++;
+    }
+    for (l = prog->data.program.vds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	n++;
+    }
+    return n;
+}
+
+// ---------- NODE COUNTING ----------
+
+static unsigned int count_stmt(AST *stmt);
+static unsigned int count_cond(AST *cond);
+static unsigned int count_expr(AST *exp);
+
+// Return the number of AST nodes in the program prog
+unsigned int optimize_count_nodes(AST *prog)
+{
+    return 1 + frame_size_of(prog) + count_stmt(prog->data.program.stmt);
+}
+
+// Return the number of AST nodes in the statement stmt
+static unsigned int count_stmt(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	return 1 + count_expr(stmt->data.assign_stmt.exp);
+    case begin_ast: {
+	unsigned int n = 1;
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    n += count_stmt(ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	return n;
+    }
+    case if_ast:
+	return 1 + count_cond(stmt->data.if_stmt.cond)
+	    + count_stmt(stmt->data.if_stmt.thenstmt)
+	    + count_stmt(stmt->data.if_stmt.elsestmt);
+    case while_ast:
+	return 1 + count_cond(stmt->data.while_stmt.cond)
+	    + count_stmt(stmt->data.while_stmt.stmt);
+    case write_ast:
+	return 1 + count_expr(stmt->data.write_stmt.exp);
+    default:
+	return 1;
+    }
+}
+
+// Return the number of AST nodes in the condition cond
+static unsigned int count_cond(AST *cond)
+{
+    if (cond->type_tag == odd_cond_ast) {
+	return 1 + count_expr(cond->data.odd_cond.exp);
+    }
+    return 1 + count_expr(cond->data.bin_cond.leftexp)
+	+ count_expr(cond->data.bin_cond.rightexp);
+}
+
+// Return the number of AST nodes in the expression exp
+static unsigned int count_expr(AST *exp)
+{
+    if (exp->type_tag == bin_expr_ast) {
+	return 1 + count_expr(exp->data.bin_expr.leftexp)
+	    + count_expr(exp->data.bin_expr.rightexp);
+    }
+    return 1;
+}
+
+// ---------- CONSTANT FOLDING ----------
+
+// For each offset in the frame, whether its declaration is a constant,
+// and if so, the constant's value
+static _Thread_local bool *is_const;
+static _Thread_local short *const_vals;
+
+static void fold_stmt(AST *stmt);
+static void fold_expr(AST *exp);
+static int cond_value(AST *cond);
+
+// Take the constants that the statement stmt assigns or reads into
+// (which the scope checker allows) out of is_const,
+// as their values can change
+static void unmark_changed_consts(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	is_const[stmt->data.assign_stmt.offset] = false;
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    unmark_changed_consts(ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast:
+	unmark_changed_consts(stmt->data.if_stmt.thenstmt);
+	unmark_changed_consts(stmt->data.if_stmt.elsestmt);
+	break;
+    case while_ast:
+	unmark_changed_consts(stmt->data.while_stmt.stmt);
+	break;
+    case read_ast:
+	is_const[stmt->data.read_stmt.offset] = false;
+	break;
+    default:
+	break;
+    }
+}
+
+// Make node (which stays in the same list, if any) become a copy of with
+static void replace_node(AST *node, AST *with)
+{
+    node->file_loc = with->file_loc;
+    node->type_tag = with->type_tag;
+    node->data = with->data;
+}
+
+// Make node become a number expression with the given value
+static void make_number(AST *node, short int value)
+{
+    node->type_tag = number_ast;
+    node->data.number.value = value;
+}
+
+// Fold the constant expressions in prog, substituting the values
+// of constants for their names, simplify arithmetic identities,
+// and replace if and while statements with constant conditions
+// by the statements that will be executed.
+static void fold_program(AST *prog)
+{
+    unsigned int frame_size = frame_size_of(prog);
+    is_const = (bool *) calloc(frame_size + 1, sizeof(bool));
+    const_vals = (short *) calloc(frame_size + 1, sizeof(short));
+    if (is_const == NULL || const_vals == NULL) {
+	bail_with_error("No space for constant folding!");
+    }
+    AST_list l;
+    for (l = prog->data.program.cds; !ast_list_is_empty(l); l = ast_list_rest(l)) {
+	AST *cd = ast_list_first(l);
+	is_const[cd->data.const_decl.offset] = true;
+	const_vals[cd->data.const_decl.offset] = cd->data.const_decl.num_val;
+    }
+    unmark_changed_consts(prog->data.program.stmt);
+    fold_stmt(prog->data.program.stmt);
+    free(is_const);
+    free(const_vals);
+}
+
+// Return 1 if the condition cond is always true, 0 if it is always false,
+// and -1 if its value is not known (as its operands are not numbers)
+static int cond_value(AST *cond)
+{
+    switch (cond->type_tag) {
+    case odd_cond_ast: {
+	AST *exp = cond->data.odd_cond.exp;
+	if (exp->type_tag == number_ast) {
+	    return exp->data.number.value % 2 != 0;
+	}
+	return -1;
+    }
+    case bin_cond_ast: {
+	AST *left = cond->data.bin_cond.leftexp;
+	AST *right = cond->data.bin_cond.rightexp;
+	if (left->type_tag != number_ast || right->type_tag != number_ast) {
+	    return -1;
+	}
+	short lv = left->data.number.value;
+	short rv = right->data.number.value;
+	switch (cond->data.bin_cond.relop) {
+	case eqop:
+	    return lv == rv;
+	case neqop:
+	    return lv != rv;
+	case ltop:
+	    return lv < rv;
+	case leqop:
+	    return lv <= rv;
+	case gtop:
+	    return lv > rv;
+	case geqop:
+	    return lv >= rv;
+	default:
+	    bail_with_error("Unknown rel_op %d", cond->data.bin_cond.relop);
+	    break;
+	}
+	break;
+    }
+    default:
+	bail_with_error("Unexpected type_tag %d in cond_value!",
+			cond->type_tag);
+	break;
+    }
+    return -1;
+}
+
+// Fold the condition cond, and return its value as cond_value does
+static int fold_cond(AST *cond)
+{
+    if (cond->type_tag == odd_cond_ast) {
+	fold_expr(cond->data.odd_cond.exp);
+    } else {
+	fold_expr(cond->data.bin_cond.leftexp);
+	fold_expr(cond->data.bin_cond.rightexp);
+    }
+    return cond_value(cond);
+}
+
+// Fold the statement stmt
+static void fold_stmt(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	fold_expr(stmt->data.assign_stmt.exp);
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    fold_stmt(ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast: {
+	int known = fold_cond(stmt->data.if_stmt.cond);
+	AST *thenstmt = stmt->data.if_stmt.thenstmt;
+	AST *elsestmt = stmt->data.if_stmt.elsestmt;
+	if (known == 1) {
+	    replace_node(stmt, thenstmt);
+	    fold_stmt(stmt);
+	} else if (known == 0) {
+	    replace_node(stmt, elsestmt);
+	    fold_stmt(stmt);
+	} else {
+	    fold_stmt(thenstmt);
+	    fold_stmt(elsestmt);
+	}
+	break;
+    }
+    case while_ast:
+	if (fold_cond(stmt->data.while_stmt.cond) == 0) {
+	    stmt->type_tag = skip_ast;
+	} else {
+	    fold_stmt(stmt->data.while_stmt.stmt);
+	}
+	break;
+    case write_ast:
+	fold_expr(stmt->data.write_stmt.exp);
+	break;
+    case read_ast:
+    case skip_ast:
+	break;
+    default:
+	bail_with_error("Call to fold_stmt with an AST that is not a statement!");
+	break;
+    }
+}
+
+// Return true just when exp is the number n
+static bool is_number(AST *exp, short int n)
+{
+    return exp->type_tag == number_ast && exp->data.number.value == n;
+}
+
+// Fold the expression exp.  Values are shorts, so folded arithmetic
+// wraps around, and a division by zero is left to happen at run time.
+static void fold_expr(AST *exp)
+{
+    switch (exp->type_tag) {
+    case bin_expr_ast: {
+	AST *left = exp->data.bin_expr.leftexp;
+	AST *right = exp->data.bin_expr.rightexp;
+	fold_expr(left);
+	fold_expr(right);
+	if (left->type_tag == number_ast && right->type_tag == number_ast) {
+	    short lv = left->data.number.value;
+	    short rv = right->data.number.value;
+	    switch (exp->data.bin_expr.arith_op) {
+	    case addop:
+		make_number(exp, (short) (lv + rv));
+		break;
+	    case subop:
+		make_number(exp, (short) (lv - rv));
+		break;
+	    case multop:
+		make_number(exp, (short) (lv * rv));
+		break;
+	    case divop:
+		if (rv != 0) {
+		    make_number(exp, (short) (lv / rv));
+		}
+		break;
+	    default:
+		bail_with_error("Unexpected bin_arith_op %d in fold_expr",
+				exp->data.bin_expr.arith_op);
+		break;
+	    }
+	    return;
+	}
+	// the identities x+0 = 0+x = x-0 = x*1 = 1*x = x/1 = x
+	switch (exp->data.bin_expr.arith_op) {
+	case addop:
+	    if (is_number(right, 0)) {
+		replace_node(exp, left);
+	    } else if (is_number(left, 0)) {
+		replace_node(exp, right);
+	    }
+	    break;
+	case subop:
+	    if (is_number(right, 0)) {
+		replace_node(exp, left);
+	    }
+	    break;
+	case multop:
+	    if (is_number(right, 1)) {
+		replace_node(exp, left);
+	    } else if (is_number(left, 1)) {
+		replace_node(exp, right);
+	    }
+	    break;
+	case divop:
+	    if (is_number(right, 1)) {
+		replace_node(exp, left);
+	    }
+	    break;
+	default:
+	    break;
+	}
+	break;
+    }
+    case ident_ast:
+	if (is_const[exp->data.ident.offset]) {
+	    make_number(exp, const_vals[exp->data.ident.offset]);
+	}
+	break;
+    case number_ast:
+	break;
+    default:
+	bail_with_error("Unexpected type_tag %d in fold_expr!",
+			exp->type_tag);
+	break;
+    }
+}
+
+// ---------- DEAD CODE ELIMINATION ----------
+
+// For each offset in the frame, the number of times its value is used
+// (by ident expressions or read statements), in the statements kept so far
+static _Thread_local unsigned int *uses;
+// whether assignments also count as uses of the variables they assign
+static _Thread_local bool counting_targets;
+
+static void dead_count_stmt(AST *stmt);
+static void dead_count_expr(AST *exp);
+static bool dead_stmt(AST *stmt);
+
+// Add ast, which is being taken out of the list it was in, to the end of b
+static void keep_ast(AST_list_builder *b, AST *ast)
+{
+    ast->next = ast_list_empty_list();
+    ast_list_builder_add(b, ast);
+}
+
+// Return the list of the declarations in decls whose values are used,
+// changing their offsets (and the given new_offsets table) to number
+// them consecutively from *next_offset on
+static AST_list dead_keep_decls(AST_list decls, unsigned int *new_offsets,
+				unsigned int *next_offset)
+{
+    AST_list_builder kept;
+    ast_list_builder_init(&kept);
+    while (!ast_list_is_empty(decls)) {
+	AST *decl = ast_list_first(decls);
+	AST_list rest = ast_list_rest(decls);
+	unsigned int *offset = decl->type_tag == const_decl_ast
+	    ? &decl->data.const_decl.offset : &decl->data.var_decl.offset;
+	if (uses[*offset] > 0) {
+	    new_offsets[*offset] = (*next_offset)++;
+	    *offset = new_offsets[*offset];
+	    keep_ast(&kept, decl);
+	}
+	decls = rest;
+    }
+    return ast_list_builder_list(&kept);
+}
+
+static void renumber_stmt(AST *stmt, unsigned int *new_offsets);
+
+// Remove the statements in prog that cannot be reached or that only
+// assign variables whose values are never used, then the declarations
+// of constants and variables that are never used (keeping the
+// variables of read statements, so their input is still consumed),
+// and renumber the offsets of those left, so the frame shrinks.
+static void dead_code_program(AST *prog)
+{
+    unsigned int frame_size = frame_size_of(prog);
+    uses = (unsigned int *) calloc(frame_size + 1, sizeof(unsigned int));
+    unsigned int *new_offsets =
+	(unsigned int *) calloc(frame_size + 1, sizeof(unsigned int));
+    if (uses == NULL || new_offsets == NULL) {
+	bail_with_error("No space for dead code elimination!");
+    }
+    // removing an assignment can make the variables it uses unused,
+    // so repeat until nothing more is removed
+    counting_targets = false;
+    bool changed = true;
+    while (changed) {
+	for (unsigned int i = 0; i < frame_size; i++) {
+	    uses[i] = 0;
+	}
+	dead_count_stmt(prog->data.program.stmt);
+	changed = dead_stmt(prog->data.program.stmt);
+    }
+    // the variables of the assignments left (whose expressions might fail)
+    // still need their places in the frame
+    counting_targets = true;
+    dead_count_stmt(prog->data.program.stmt);
+    unsigned int next_offset = 0;
+    prog->data.program.cds =
+	dead_keep_decls(prog->data.program.cds, new_offsets, &next_offset);
+    prog->data.program.vds =
+	dead_keep_decls(prog->data.program.vds, new_offsets, &next_offset);
+    renumber_stmt(prog->data.program.stmt, new_offsets);
+    free(uses);
+    free(new_offsets);
+}
+
+// Count the uses of values in the statement stmt
+static void dead_count_stmt(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	if (counting_targets) {
+	    uses[stmt->data.assign_stmt.offset]++;
+	}
+	dead_count_expr(stmt->data.assign_stmt.exp);
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    dead_count_stmt(ast_list_first(stmts));
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast:
+	dead_count_expr(stmt->data.if_stmt.cond);
+	dead_count_stmt(stmt->data.if_stmt.thenstmt);
+	dead_count_stmt(stmt->data.if_stmt.elsestmt);
+	break;
+    case while_ast:
+	dead_count_expr(stmt->data.while_stmt.cond);
+	dead_count_stmt(stmt->data.while_stmt.stmt);
+	break;
+    case read_ast:
+	uses[stmt->data.read_stmt.offset]++;
+	break;
+    case write_ast:
+	dead_count_expr(stmt->data.write_stmt.exp);
+	break;
+    default:
+	break;
+    }
+}
+
+// Count the uses of values in exp, which may also be a condition
+static void dead_count_expr(AST *exp)
+{
+    switch (exp->type_tag) {
+    case odd_cond_ast:
+	dead_count_expr(exp->data.odd_cond.exp);
+	break;
+    case bin_cond_ast:
+	dead_count_expr(exp->data.bin_cond.leftexp);
+	dead_count_expr(exp->data.bin_cond.rightexp);
+	break;
+    case bin_expr_ast:
+	dead_count_expr(exp->data.bin_expr.leftexp);
+	dead_count_expr(exp->data.bin_expr.rightexp);
+	break;
+    case ident_ast:
+	uses[exp->data.ident.offset]++;
+	break;
+    default:
+	break;
+    }
+}
+
+// Return true just when evaluating exp cannot fail
+// (i.e., it cannot divide by zero)
+static bool cannot_fail(AST *exp)
+{
+    if (exp->type_tag != bin_expr_ast) {
+	return true;
+    }
+    AST *right = exp->data.bin_expr.rightexp;
+    if (exp->data.bin_expr.arith_op == divop
+	&& (right->type_tag != number_ast || right->data.number.value == 0)) {
+	return false;
+    }
+    return cannot_fail(exp->data.bin_expr.leftexp) && cannot_fail(right);
+}
+
+// Return true just when evaluating the condition cond cannot fail
+static bool cond_cannot_fail(AST *cond)
+{
+    if (cond->type_tag == odd_cond_ast) {
+	return cannot_fail(cond->data.odd_cond.exp);
+    }
+    return cannot_fail(cond->data.bin_cond.leftexp)
+	&& cannot_fail(cond->data.bin_cond.rightexp);
+}
+
+// Remove the dead statements in stmt, making stmt a skip statement
+// if it is dead itself, and return true just when anything was removed
+static bool dead_stmt(AST *stmt)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	if (uses[stmt->data.assign_stmt.offset] == 0
+	    && cannot_fail(stmt->data.assign_stmt.exp)) {
+	    stmt->type_tag = skip_ast;
+	    return true;
+	}
+	return false;
+    case begin_ast: {
+	bool changed = false;
+	bool reachable = true;
+	AST_list_builder kept;
+	ast_list_builder_init(&kept);
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    AST *s = ast_list_first(stmts);
+	    AST_list rest = ast_list_rest(stmts);
+	    if (!reachable) {
+		changed = true;
+	    } else {
+		changed = dead_stmt(s) || changed;
+		if (s->type_tag == skip_ast) {
+		    changed = true;
+		} else {
+		    keep_ast(&kept, s);
+		    // nothing after a loop that never ends can be reached
+		    if (s->type_tag == while_ast
+			&& cond_value(s->data.while_stmt.cond) == 1) {
+			reachable = false;
+		    }
+		}
+	    }
+	    stmts = rest;
+	}
+	AST_list kept_stmts = ast_list_builder_list(&kept);
+	if (ast_list_is_empty(kept_stmts)) {
+	    stmt->type_tag = skip_ast;
+	    return true;
+	} else if (ast_list_is_empty(ast_list_rest(kept_stmts))) {
+	    replace_node(stmt, ast_list_first(kept_stmts));
+	    return true;
+	}
+	stmt->data.begin_stmt.stmts = kept_stmts;
+	return changed;
+    }
+    case if_ast: {
+	bool changed = dead_stmt(stmt->data.if_stmt.thenstmt);
+	changed = dead_stmt(stmt->data.if_stmt.elsestmt) || changed;
+	if (stmt->data.if_stmt.thenstmt->type_tag == skip_ast
+	    && stmt->data.if_stmt.elsestmt->type_tag == skip_ast
+	    && cond_cannot_fail(stmt->data.if_stmt.cond)) {
+	    stmt->type_tag = skip_ast;
+	    return true;
+	}
+	return changed;
+    }
+    case while_ast:
+	return dead_stmt(stmt->data.while_stmt.stmt);
+    default:
+	return false;
+    }
+}
+
+static void renumber_expr(AST *exp, unsigned int *new_offsets);
+
+// Change the offsets used in stmt to those given by new_offsets
+static void renumber_stmt(AST *stmt, unsigned int *new_offsets)
+{
+    switch (stmt->type_tag) {
+    case assign_ast:
+	stmt->data.assign_stmt.offset = new_offsets[stmt->data.assign_stmt.offset];
+	renumber_expr(stmt->data.assign_stmt.exp, new_offsets);
+	break;
+    case begin_ast: {
+	AST_list stmts = stmt->data.begin_stmt.stmts;
+	while (!ast_list_is_empty(stmts)) {
+	    renumber_stmt(ast_list_first(stmts), new_offsets);
+	    stmts = ast_list_rest(stmts);
+	}
+	break;
+    }
+    case if_ast:
+	renumber_expr(stmt->data.if_stmt.cond, new_offsets);
+	renumber_stmt(stmt->data.if_stmt.thenstmt, new_offsets);
+	renumber_stmt(stmt->data.if_stmt.elsestmt, new_offsets);
+	break;
+    case while_ast:
+	renumber_expr(stmt->data.while_stmt.cond, new_offsets);
+	renumber_stmt(stmt->data.while_stmt.stmt, new_offsets);
+	break;
+    case read_ast:
+	stmt->data.read_stmt.offset = new_offsets[stmt->data.read_stmt.offset];
+	break;
+    case write_ast:
+	renumber_expr(stmt->data.write_stmt.exp, new_offsets);
+	break;
+    default:
+	break;
+    }
+}
+
+// Change the offsets used in exp (which may also be a condition)
+// to those given by new_offsets
+static void renumber_expr(AST *exp, unsigned int *new_offsets)
+{
+    switch (exp->type_tag) {
+    case odd_cond_ast:
+	renumber_expr(exp->data.odd_cond.exp, new_offsets);
+	break;
+    case bin_cond_ast:
+	renumber_expr(exp->data.bin_cond.leftexp, new_offsets);
+	renumber_expr(exp->data.bin_cond.rightexp, new_offsets);
+	break;
+    case bin_expr_ast:
+	renumber_expr(exp->data.bin_expr.leftexp, new_offsets);
+	renumber_expr(exp->data.bin_expr.rightexp, new_offsets);
+	break;
+    case ident_ast:
+	exp->data.ident.offset = new_offsets[exp->data.ident.offset];
+	break;
+    default:
+	break;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef _OPTIMIZE_H
+#define _OPTIMIZE_H
+#include <stdio.h>
+#include "ast.h"
+
+// Requires: prog is a program AST that has been scope checked
+// (so the offsets of names in it are filled in)
+// Run each optimization pass over prog, changing its ASTs in place
+// into ones that mean the same thing (when run by any backend).
+// If report is not NULL, write to it the number of AST nodes
+// in prog before and after each pass.
+extern void optimize_program(AST *prog, FILE *report);
+
+// Return the number of AST nodes in the program prog
+extern unsigned int optimize_count_nodes(AST *prog);
+
+#endif
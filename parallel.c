@@ -0,0 +1,190 @@
+// Compiling many units at once, on a work-stealing pool of threads
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "utilities.h"
+#include "parallel.h"
+
+// The result of compiling a unit
+typedef struct {
+    char *out;		// what it wrote on its output
+    size_t out_len;
+    char *err;		// what it wrote on its error stream
+    size_t err_len;
+    int status;
+    bool done;
+} unit_result;
+
+// The units a thread has left to compile: those with indexes in
+// [first, last).  The owner takes units from the front, in order,
+// and other threads steal them from the back.
+typedef struct {
+    pthread_mutex_t lock;
+    unsigned int first;
+    unsigned int last;
+} work_queue;
+
+// What all the threads share
+typedef struct {
+    compile_options *opts;
+    const char **fnames;
+    unit_result *results;
+    work_queue *queues;
+    unsigned int num_threads;
+    // protects the done fields of results, and signals when one is set
+    pthread_mutex_t done_lock;
+    pthread_cond_t done_cond;
+} pool;
+
+// A thread's view of the pool
+typedef struct {
+    pool *p;
+    unsigned int id;
+} worker;
+
+// Take the next unit from q, putting its index in *unit,
+// and return true, or return false if q is empty
+static bool queue_take(work_queue *q, unsigned int *unit)
+{
+    bool found = false;
+    pthread_mutex_lock(&q->lock);
+    if (q->first < q->last) {
+	*unit = q->first++;
+	found = true;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+// Move the back half of the units of victim into the (empty) queue q,
+// and return true just when any were moved
+static bool queue_steal(work_queue *q, work_queue *victim)
+{
+    unsigned int first = 0, last = 0;
+    pthread_mutex_lock(&victim->lock);
+    if (victim->first < victim->last) {
+	last = victim->last;
+	first = last - (last - victim->first + 1) / 2;
+	victim->last = first;
+    }
+    pthread_mutex_unlock(&victim->lock);
+    if (first == last) {
+	return false;
+    }
+    pthread_mutex_lock(&q->lock);
+    q->first = first;
+    q->last = last;
+    pthread_mutex_unlock(&q->lock);
+    return true;
+}
+
+// Compile the unit with index unit, collecting its results
+static void compile_pool_unit(pool *p, unsigned int unit)
+{
+    unit_result *r = &p->results[unit];
+    FILE *out = open_memstream(&r->out, &r->out_len);
+    FILE *err = open_memstream(&r->err, &r->err_len);
+    if (out == NULL || err == NULL) {
+	bail_with_error("Cannot make buffers for the output of %s",
+			p->fnames[unit]);
+    }
+    compile_context ctx = {*p->opts, out, err};
+    int status = compile_file(&ctx, p->fnames[unit]);
+    fclose(out);
+    fclose(err);
+    pthread_mutex_lock(&p->done_lock);
+    r->status = status;
+    r->done = true;
+    pthread_cond_broadcast(&p->done_cond);
+    pthread_mutex_unlock(&p->done_lock);
+}
+
+// Compile units from the thread's own queue until it is empty,
+// then steal from the others, until there are none left anywhere
+static void *worker_run(void *arg)
+{
+    worker *w = (worker *) arg;
+    pool *p = w->p;
+    work_queue *mine = &p->queues[w->id];
+    for (;;) {
+	unsigned int unit;
+	while (queue_take(mine, &unit)) {
+	    compile_pool_unit(p, unit);
+	}
+	bool stole = false;
+	for (unsigned int i = 1; i < p->num_threads && !stole; i++) {
+	    stole = queue_steal(mine, &p->queues[(w->id + i) % p->num_threads]);
+	}
+	if (!stole) {
+	    return NULL;
+	}
+    }
+}
+
+// Compile the units named in fnames on num_threads threads,
+// writing their results in order, and return the number that failed
+unsigned int compile_parallel(compile_options *opts, const char **fnames,
+			      unsigned int num_units, unsigned int num_threads)
+{
+    pool p;
+    p.opts = opts;
+    p.fnames = fnames;
+    p.num_threads = num_threads;
+    p.results = (unit_result *) calloc(num_units + 1, sizeof(unit_result));
+    p.queues = (work_queue *) calloc(num_threads, sizeof(work_queue));
+    worker *workers = (worker *) calloc(num_threads, sizeof(worker));
+    pthread_t *threads = (pthread_t *) calloc(num_threads, sizeof(pthread_t));
+    if (p.results == NULL || p.queues == NULL
+	|| workers == NULL || threads == NULL) {
+	bail_with_error("No space for %u threads!", num_threads);
+    }
+    pthread_mutex_init(&p.done_lock, NULL);
+    pthread_cond_init(&p.done_cond, NULL);
+
+    // each thread starts with a contiguous share of the units
+    for (unsigned int t = 0; t < num_threads; t++) {
+	pthread_mutex_init(&p.queues[t].lock, NULL);
+	p.queues[t].first = (unsigned int) ((unsigned long) num_units * t / num_threads);
+	p.queues[t].last = (unsigned int) ((unsigned long) num_units * (t+1) / num_threads);
+	workers[t].p = &p;
+	workers[t].id = t;
+    }
+    for (unsigned int t = 0; t < num_threads; t++) {
+	if (pthread_create(&threads[t], NULL, worker_run, &workers[t]) != 0) {
+	    bail_with_error("Cannot create a thread!");
+	}
+    }
+
+    // write the results in order, as soon as each is done
+    unsigned int failures = 0;
+    for (unsigned int u = 0; u < num_units; u++) {
+	unit_result *r = &p.results[u];
+	pthread_mutex_lock(&p.done_lock);
+	while (!r->done) {
+	    pthread_cond_wait(&p.done_cond, &p.done_lock);
+	}
+	pthread_mutex_unlock(&p.done_lock);
+	fwrite(r->out, 1, r->out_len, stdout);
+	fflush(stdout);
+	fwrite(r->err, 1, r->err_len, stderr);
+	compile_report_status(stderr, fnames[u], r->status);
+	if (r->status != EXIT_SUCCESS) {
+	    failures++;
+	}
+	free(r->out);
+	free(r->err);
+    }
+
+    for (unsigned int t = 0; t < num_threads; t++) {
+	pthread_join(threads[t], NULL);
+	pthread_mutex_destroy(&p.queues[t].lock);
+    }
+    pthread_cond_destroy(&p.done_cond);
+    pthread_mutex_destroy(&p.done_lock);
+    free(threads);
+    free(workers);
+    free(p.queues);
+    free(p.results);
+    return failures;
+}
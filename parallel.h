@@ -0,0 +1,19 @@
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+#include "compile.h"
+
+// Requires: num_threads > 0 and fnames has num_units elements
+// Compile each of the units named in fnames as opts say,
+// spreading them over num_threads threads (which steal units
+// from each other when they run out of their own).
+// Each unit's output and error messages are collected separately,
+// then written on stdout and stderr in the order of fnames,
+// followed on stderr by its exit status (see compile_report_status),
+// so the result is the same as compiling the units one at a time.
+// Return the number of units that failed.
+extern unsigned int compile_parallel(compile_options *opts,
+				     const char **fnames,
+				     unsigned int num_units,
+				     unsigned int num_threads);
+
+#endif
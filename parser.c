@@ -2,60 +2,189 @@
 // Cited From Float Language
 // Talked conceptually with Group 25 - HagMik
 // Parser and Declaration Checker.c
+#define _POSIX_C_SOURCE 200809L
 #include "parser.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-// The input file's name
-
-static char *filename = NULL;
-static token tok;
+static _Thread_local token tok;
+// if not NULL, told about each statement parsed (see parser_set_stmt_listener)
+static _Thread_local void (*stmt_listener)(AST *stmt, token follow);
 static unsigned int scope_offset;
 
+// Print a usage message on stderr and exit with failure.
+static void usage(const char *cmdname)
+{
+    fprintf(stderr,
+            "Usage: %s [-stats[=json]] [-C cache-dir | -e edits-file]"
+            " [-l | -T tokens-file"
+            " | [-O] [-v] (-r | -o bytecode-file | -S asm-file)]"
+            " code-filename\n"
+            "   or: %s (--batch | -j N) [-stats[=json]] [-C cache-dir]"
+            " [-l | [-O [-v]] -r]"
+            " (code-filename | @listfile)...\n"
+            "  -l       print the tokens of the file\n"
+            "  -T file  write the tokens of the file to file as a binary token\n"
+            "           stream, which can be given instead of the code file later\n"
+            "  -r       run the program (by interpreting its AST)\n"
+            "  -o file  compile to bytecode (for the vm) in file\n"
+            "  -S file  compile to x86-64 assembly (link with pl0rt.c) in file\n"
+            "  -O       optimize the program first\n"
+            "  -v       report the AST node counts for each optimization pass\n"
+            "           (and, with -e, what each edit parsed again)\n"
+            "  -C dir   keep the scope checked ASTs of the files in the directory\n"
+            "           dir, and use them instead of parsing unchanged files again\n"
+            "  -e file  compile the code file as edited by the edits in file\n"
+            "           (- for stdin), parsing again after each just what it\n"
+            "           changes, and reporting its errors; each edit is a line\n"
+            "           'start end len' followed by the len chars that replace\n"
+            "           the chars from offset start up to offset end\n"
+            "  -stats   report each file's time per phase, tokens and AST nodes\n"
+            "           by type, symbol table probes, AST cache hits and misses,\n"
+            "           and allocations on stderr\n"
+            "           (as one line of JSON with -stats=json)\n"
+            "  --batch  handle each file (or each file named in a listfile,\n"
+            "           one per line) in turn, reporting its exit status\n"
+            "  -j N     like --batch, but compile on N threads at once\n"
+            "           (not with -r), writing the results in the same order\n",
+            cmdname, cmdname);
+    exit(EXIT_FAILURE);
+}
+
+// The names of the files to compile in a batch
+typedef struct {
+    const char **names;
+    unsigned int count;
+    unsigned int capacity;
+} unit_list;
+
+// Add the file name fname to the end of units
+static void add_unit(unit_list *units, const char *fname)
+{
+    if (units->count == units->capacity)
+    {
+        units->capacity = units->capacity == 0 ? 64 : 2 * units->capacity;
+        units->names = realloc(units->names,
+                               units->capacity * sizeof(const char *));
+        if (units->names == NULL)
+            bail_with_error("No space for the names of the files to compile!");
+    }
+    units->names[units->count++] = fname;
+}
+
+// Add each file named in the file listname (one per line) to units
+static void add_listed_units(unit_list *units, const char *listname)
+{
+    FILE *list = fopen(listname, "r");
+    if (list == NULL)
+        bail_with_error("Cannot open %s", listname);
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    while ((len = getline(&line, &line_size, list)) != -1)
+    {
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\0';
+        if (len > 0)
+            add_unit(units, strdup(line));
+    }
+    free(line);
+    fclose(list);
+}
+
 int main(int argc, char *argv[])
 {   
     const char *cmdname = argv[0];
     int filename_index = 1;
-    bool produce_lexer_output = false;
+    bool batch = false;
+    unsigned int jobs = 1;
+    compile_context ctx = {{false, false, false, false, NULL, NULL, NULL, NULL, NULL, stats_none},
+                           stdout, stderr};
+    compile_options *opts = &ctx.opts;
     
-    // based on number of arguments the filename index will differ
-    if ( argc >= 2 && strcmp(argv[1],"-l") == 0 ) 
+    // options come before the file name
+    while (filename_index < argc && argv[filename_index][0] == '-')
     {
-        produce_lexer_output = true;
-        filename_index = 2;
+        if (strcmp(argv[filename_index],"-l") == 0)
+            opts->lexer_output = true;
+        else if (strcmp(argv[filename_index],"-r") == 0)
+            opts->run = true;
+        else if (strcmp(argv[filename_index],"-O") == 0)
+            opts->optimize = true;
+        else if (strcmp(argv[filename_index],"-v") == 0)
+            opts->verbose = true;
+        else if (strcmp(argv[filename_index],"-stats") == 0)
+            opts->stats = stats_text;
+        else if (strcmp(argv[filename_index],"-stats=json") == 0)
+            opts->stats = stats_json;
+        else if (strcmp(argv[filename_index],"--batch") == 0)
+            batch = true;
+        else if (strcmp(argv[filename_index],"-j") == 0 && filename_index+1 < argc
+                 && atoi(argv[filename_index+1]) > 0)
+        {
+            jobs = (unsigned int) atoi(argv[++filename_index]);
+            batch = true;
+        }
+        else if (strcmp(argv[filename_index],"-o") == 0 && filename_index+1 < argc)
+            opts->code_filename = argv[++filename_index];
+        else if (strcmp(argv[filename_index],"-S") == 0 && filename_index+1 < argc)
+            opts->asm_filename = argv[++filename_index];
+        else if (strcmp(argv[filename_index],"-T") == 0 && filename_index+1 < argc)
+            opts->tokens_filename = argv[++filename_index];
+        else if (strcmp(argv[filename_index],"-C") == 0 && filename_index+1 < argc)
+            opts->cache_dirname = argv[++filename_index];
+        else if (strcmp(argv[filename_index],"-e") == 0 && filename_index+1 < argc)
+            opts->edits_filename = argv[++filename_index];
+        else
+            usage(cmdname);
+        filename_index++;
     }
-    else if ( argc == 2 )
-        filename_index = 1;
-
-    // if true use Lexer functions
-    if (produce_lexer_output) {
-        filename = argv[filename_index];
-        lexer_open(filename);
-        lexer_output();
-        lexer_close();
+
+    if (!batch)
+    {
+        if (filename_index != argc-1)
+            usage(cmdname);
+        return compile_file(&ctx, argv[filename_index]);
+    }
+
+    // in a batch, each file would overwrite the same output file,
+    // and programs run at the same time would share their input
+    if (filename_index == argc || opts->code_filename != NULL
+        || opts->asm_filename != NULL || opts->tokens_filename != NULL
+        || opts->edits_filename != NULL || (jobs > 1 && opts->run))
+        usage(cmdname);
+    unit_list units = {NULL, 0, 0};
+    for (; filename_index < argc; filename_index++)
+    {
+        if (argv[filename_index][0] == '@')
+            add_listed_units(&units, argv[filename_index]+1);
+        else
+            add_unit(&units, argv[filename_index]);
     }
+
+    unsigned int failures = 0;
+    if (jobs > 1)
+        failures = compile_parallel(opts, units.names, units.count, jobs);
     else
     {
-        // otherwise run parser like normal
-        filename = argv[1];
-        parser_open(filename);
-        AST *progast = parseProgram();
-        parser_close();
-        unparseProgram(stdout,progast);
-
-        scope_initialize();
-        scope_check_program(progast);
+        for (unsigned int i = 0; i < units.count; i++)
+        {
+            int status = compile_file(&ctx, units.names[i]);
+            compile_report_status(stderr, units.names[i], status);
+            if (status != EXIT_SUCCESS)
+                failures++;
+        }
     }
-    return EXIT_SUCCESS;
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 // ---------- PARSER OPERATION FUNCTIONS ----------
 
 // initialize the parser to work on the given file
-void parser_open(const char *filename)
+void parser_open(const char *fname)
 { 
-    lexer_open(filename);
+    lexer_open(fname);
     tok = lexer_next();
     //scope_offset = 0;
 }
@@ -66,6 +195,27 @@ void parser_close()
     lexer_close();
 }
 
+// initialize the parser to work on the len chars at text,
+// which are the file named fname (with id file) from offset on
+void parser_open_text(const char *fname, unsigned int file,
+                      const char *text, size_t len, unsigned int offset)
+{
+    lexer_open_text(fname, file, text, len, offset);
+    tok = lexer_next();
+}
+
+// return the current (lookahead) token
+token parser_token()
+{
+    return tok;
+}
+
+// make listener be told about each statement parsed
+void parser_set_stmt_listener(void (*listener)(AST *stmt, token follow))
+{
+    stmt_listener = listener;
+}
+
 // advance the parser and update the token
 static void advance() 
 {
@@ -108,67 +258,58 @@ AST *parseProgram()
     else 
 	    f_locate = stmt->file_loc;
 
-    return ast_program(filename,f_locate.line,f_locate.column,consts,vars,stmt);
+    return ast_program(f_locate,consts,vars,stmt);
 }
 
 
-static AST_list parseVars()
+AST_list parseVars()
 {
-    // create a empty list for the head and tail of the variable list
-    AST_list varHead = ast_list_empty_list(), varTail = ast_list_empty_list();
-    // while there are varsym tokens keep adding them inserting at the back of the list
+    // build the list of variable declarations, adding each at the back
+    AST_list_builder vars;
+    ast_list_builder_init(&vars);
+    // while there are varsym tokens keep adding their identifiers
     while (tok.typ == varsym)
     {
-        AST_list varASTs;
-        var_decl_t var;
-        while (tok.typ == varsym)
-        {
-            eat(varsym);
-            var.name = tok.text;
-            varASTs = parseIdents_VAR(var);
-            eat(semisym);
-            AST_insert_back(&varHead,&varTail,varASTs);
-        }
+        eat(varsym);
+        parseIdents_VAR(&vars);
+        eat(semisym);
     }
-    return varHead;
+    return ast_list_builder_list(&vars);
 }
 
-static AST_list parseIdents_VAR(var_decl_t var)
+static void parseIdents_VAR(AST_list_builder *vars)
 {
-    // create an list for indents based on the var head and tail
+    // add a var declaration for each of the comma-separated idents
     token ident_tok = tok;
     eat(identsym);
-    AST_list varHead = ast_list_singleton(ast_var_decl(ident_tok, ident_tok.text));
-    AST_list varTail = varHead;
+    ast_list_builder_add(vars, ast_var_decl(ident_tok, ident_tok.text));
 
     while (tok.typ == commasym)
     {
         eat(commasym); // will lexer next over commas and continue.
         ident_tok = tok;
         eat(identsym);
-        AST *vars = ast_var_decl(ident_tok,ident_tok.text);
-        AST_insert_back(&varHead,&varTail,ast_list_singleton(vars));
+        ast_list_builder_add(vars, ast_var_decl(ident_tok, ident_tok.text));
     }
-    return varHead;    
 }
 
-static AST_list parseConsts()
+AST_list parseConsts()
 {
-    // create an empty list for the head and tail of the constant list
-    AST_list constHead = ast_list_empty_list(), constTail = ast_list_empty_list();
-    // while there are constsym tokens keep adding them inserting at the back of the list
+    // build the list of constant declarations, adding each at the back
+    AST_list_builder consts;
+    ast_list_builder_init(&consts);
+    // while there are constsym tokens keep adding their definitions
     while (tok.typ == constsym)
     {
         eat(constsym);
-        AST_list constASTs; 
-        constASTs = parseIdents_CONST();
+        parseIdents_CONST(&consts);
         eat(semisym);
-        AST_insert_back(&constHead,&constTail,constASTs);
     }
-    return constHead;
+    return ast_list_builder_list(&consts);
 }
-// Parses indents for constant symbols returning the head of an AST_list
-static AST_list parseIdents_CONST()
+
+// Parses a const definition (ident = number) and adds its AST to consts
+static void parseConstDef(AST_list_builder *consts)
 {
     token ident_tok = tok;
     eat(identsym);
@@ -176,40 +317,19 @@ static AST_list parseIdents_CONST()
 
     token const_val = tok;
     eat(numbersym);
-    
-    // creates head and tail of the AST_list for const within the indents, setting the head equal to the tail
-    AST_list constHead = ast_list_singleton(ast_const_def(ident_tok,ident_tok.text,const_val.value));
-    AST_list constTail = constHead;
-
-    // while token type is equal to the commasym, build the rest of the AST_list inserting from the back
-    while (tok.typ == commasym)
-    {
-        eat(commasym);
-        ident_tok = tok;
-        eat(identsym);
-        eat(eqsym);
-
-        const_val = tok;
-        eat(numbersym);
-        AST *new = ast_list_singleton(ast_const_def(ident_tok,ident_tok.text,const_val.value));
-
-        AST_insert_back(&constHead,&constTail,new);
-    }
-    return constHead;    
+    ast_list_builder_add(consts, ast_const_def(ident_tok, ident_tok.text, const_val.value));
 }
 
-// This function inserts the ast to the back of the list making the oldest AST the head and the newest AST the tail
-static void AST_insert_back(AST_list *head, AST_list *tail, AST_list list)
+// Parses the comma-separated const definitions, adding their ASTs to consts
+static void parseIdents_CONST(AST_list_builder *consts)
 {
-    if (!ast_list_is_empty(*head))
-    {
-        ast_list_splice(*tail,list);
-        *tail = ast_list_last_elem(list);
-    }
-    else
+    parseConstDef(consts);
+
+    // while token type is equal to the commasym, add the rest at the back
+    while (tok.typ == commasym)
     {
-        *head = list;
-        *tail = ast_list_last_elem(list);
+        eat(commasym);
+        parseConstDef(consts);
     }
 }
 
@@ -256,6 +376,8 @@ AST *parseStmt()
         }
         break;
     }
+    if (stmt_listener != NULL)
+        stmt_listener(ret, tok);
     return ret;
 }
 
@@ -508,18 +630,18 @@ AST *parseBeginStmt()
     token begin_tok = tok;
     eat(beginsym);
     
-    AST_list stmts = ast_list_singleton(parseStmt());
-    AST_list last = stmts;
+    AST_list_builder stmts;
+    ast_list_builder_init(&stmts);
+    ast_list_builder_add(&stmts, parseStmt());
     
     while(tok.typ == semisym)
     {
         eat(semisym);
-        AST *stmt = parseStmt();
-        AST_insert_back(&stmts, &last, ast_list_singleton(stmt));
+        ast_list_builder_add(&stmts, parseStmt());
     }
     
     eat(endsym);
-    AST *begin_ret = ast_begin_stmt(begin_tok,stmts);
+    AST *begin_ret = ast_begin_stmt(begin_tok,ast_list_builder_list(&stmts));
 
     return begin_ret;
 }
@@ -9,34 +9,23 @@
 #include "scope_check.h"
 #include "scope_symtab.h"
 #include "type_attrs.h"
+#include "gen_code.h"
+#include "interpret.h"
+#include "gen_asm.h"
+#include "optimize.h"
+#include "compile.h"
+#include "parallel.h"
+#include "parser_api.h"
 
 // Advances the lexer by fetching the next token from the input source
 static void advance();
 
-// Checks if the next token in the input source is of the expected token type and consumes it.
-// If invalid token, throws error.
-void eat(token_type token);
+// Adds var declaration ASTs for the comma-separated identifiers to vars.
+static void parseIdents_VAR(AST_list_builder *vars);
 
-// Parses the input source and generates an AST for the entire program.
-AST *parseProgram();
 
-// Parses the variable declarations and generates an AST list for them.
-static AST_list parseVars();
-
-// Generates an AST list for indentifer for variable declarations.
-static AST_list parseIdents_VAR(var_decl_t var);
-
-// Parses the constant declarations and generates an AST list for them.
-static AST_list parseConsts();
-
-
-
-// inserts the given AST_list into the linked list starting from head and updating the tail.
-static void AST_insert_back(AST_list *head, AST_list *tail, AST_list list);
-
-// Parses a statement and generates an AST for it.
-// <stmt> ::= <ident> = <expr> ; | ...
-AST *parseStmt();
+// Parses a const definition (ident = number) and adds its AST to consts.
+static void parseConstDef(AST_list_builder *consts);
 
 
 // Parses an expression and generates an AST for it.
@@ -114,14 +103,8 @@ static AST *parseTerm();
 // constructs an AST node representing the signed term. The function returns a pointer to the constructed AST node.
 static AST *parseSign();
 
-// initalize the parser for some file "filename"
-void parser_open(const char *filename);
-
-// close the parser which also closes the lexer.
-void parser_close();
-
 // returns true if the given node is a valid statement beginning token.
 static bool is_stmt_beginning_token(token t);
 
-// creates an ast_list of indentifiers for constant declarations.
-static AST_list parseIdents_CONST();
+// adds const definition ASTs for the comma-separated definitions to consts.
+static void parseIdents_CONST(AST_list_builder *consts);
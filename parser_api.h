@@ -0,0 +1,51 @@
+#ifndef _PARSER_API_H
+#define _PARSER_API_H
+#include <stddef.h>
+#include "ast.h"
+#include "token.h"
+
+// The parser's functions used by the rest of the compiler
+// (parser.h is the parser's own header, with the rest of its grammar)
+
+// Requires: filename is the name of a readable file
+// Initialize the parser (and the lexer) for the file named filename
+extern void parser_open(const char *filename);
+
+// Initialize the parser for the len chars at text, which are the contents
+// of the (recorded) file named fname, with id file, from offset on
+// (see lexer_open_text), so part of a file can be parsed again
+extern void parser_open_text(const char *fname, unsigned int file,
+			     const char *text, size_t len,
+			     unsigned int offset);
+
+// Close the parser, which also closes the lexer
+extern void parser_close();
+
+// Parse the whole program (up to and including its period and
+// the end of the file) and return its AST
+extern AST *parseProgram();
+
+// Parse the constant declarations (if any) and return their ASTs
+extern AST_list parseConsts();
+
+// Parse the variable declarations (if any) and return their ASTs
+extern AST_list parseVars();
+
+// Parse a statement and return its AST
+extern AST *parseStmt();
+
+// Consume the current token, which must be of type tt
+// (otherwise that is a syntax error, which bails)
+extern void eat(token_type tt);
+
+// Return the parser's current (lookahead) token,
+// which is the token after what was parsed last
+extern token parser_token();
+
+// Make the parser call listener (if it is not NULL) after parsing
+// each statement, with the statement's AST and the token after it,
+// so a caller can find where each statement ends
+extern void parser_set_stmt_listener(void (*listener)(AST *stmt,
+						      token follow));
+
+#endif
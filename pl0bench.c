@@ -0,0 +1,388 @@
+// End-to-end benchmark of the compiler's front end: for each file given,
+// time lexing it, parsing it, scope checking the AST, and unparsing
+// the AST (to /dev/null), each separately, and report the throughput
+// and the peak resident set size of the process so far.
+// Parsing includes the lexing the parser does,
+// so the parse time minus the lex time is the parser's own time.
+// With -C dir, instead time compiling each file (unparsing it
+// to /dev/null) with the AST cache in dir (see ast_cache.h) twice:
+// cold (parsing and scope checking it, and storing its AST in the cache)
+// and then hot (loading its AST from the cache).
+// With -E n, instead time opening an edit session on each file
+// (see reparse.h) and then making n single char edits in it, in turn
+// changing a digit, inserting a space before some white space,
+// and deleting that space again, each at a pseudo-random place
+// (usually within 1000 chars of the last edit, but every 64th anywhere);
+// the edited program is then checked against parsing its text afresh.
+// See the bench and bench-cache targets in the Makefile, which run it
+// on programs of several sizes written by pl0gen, one process per program
+// (so that each peak RSS is for one program).
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "utilities.h"
+#include "lexer.h"
+#include "parser_api.h"
+#include "scope_check.h"
+#include "scope_symtab.h"
+#include "optimize.h"
+#include "unparser.h"
+#include "compile.h"
+#include "reparse.h"
+
+// the compiler's own main is renamed (with -Dmain=compiler_main)
+// when it is linked into this benchmark
+#undef main
+
+// Return the current time in seconds
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Return the peak resident set size of this process in KB
+static long peak_rss_kb()
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+// Print one line of measurements for the file named fname on stdout
+static void bench_file(const char *fname, FILE *devnull)
+{
+    struct stat st;
+    if (stat(fname, &st) != 0) {
+	bail_with_error("Cannot stat %s", fname);
+    }
+
+    double start = now();
+    unsigned long tokens = 0;
+    lexer_open(fname);
+    while (!lexer_done()) {
+	lexer_next();
+	tokens++;
+    }
+    lexer_close();
+    double lex_secs = now() - start;
+
+    start = now();
+    parser_open(fname);
+    AST *progast = parseProgram();
+    parser_close();
+    double parse_secs = now() - start;
+    unsigned int nodes = optimize_count_nodes(progast);
+
+    start = now();
+    scope_initialize();
+    scope_check_program(progast);
+    double scope_secs = now() - start;
+
+    start = now();
+    unparseProgram(devnull, progast);
+    fflush(devnull);
+    double unparse_secs = now() - start;
+
+    printf("%-24s %10lld %10lu %10u"
+	   " %8.1f %8.2f %8.1f %8.2f %8.1f %8.2f %8.1f %8.2f %9ld\n",
+	   fname, (long long) st.st_size, tokens, nodes,
+	   1000 * lex_secs, tokens / lex_secs / 1e6,
+	   1000 * parse_secs, tokens / parse_secs / 1e6,
+	   1000 * scope_secs, nodes / scope_secs / 1e6,
+	   1000 * unparse_secs, nodes / unparse_secs / 1e6,
+	   peak_rss_kb());
+    fflush(stdout);
+
+    scope_finalize();
+    ast_arena_release();
+    lexer_release();
+}
+
+// Compile the file named fname as ctx says, with the AST cache,
+// returning how long it took, and bailing with an error message
+// if it was not a hit (if hit) or a miss (if !hit)
+static double time_cached_compile(compile_context *ctx, const char *fname,
+				  bool hit)
+{
+    double start = now();
+    if (compile_file(ctx, fname) != EXIT_SUCCESS) {
+	bail_with_error("Cannot compile %s", fname);
+    }
+    double ret = now() - start;
+    if (unit_stats.cache_hits != (hit ? 1 : 0)) {
+	bail_with_error("%s was %sin the AST cache %s", fname,
+			hit ? "not " : "", ctx->opts.cache_dirname);
+    }
+    return ret;
+}
+
+// Print one line of measurements of compiling the file named fname
+// cold and hot with the AST cache in the directory dir on stdout
+static void bench_cached_file(const char *fname, const char *dir,
+			      FILE *devnull)
+{
+    struct stat st;
+    if (stat(fname, &st) != 0) {
+	bail_with_error("Cannot stat %s", fname);
+    }
+    compile_context ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.opts.cache_dirname = dir;
+    ctx.out = devnull;
+    ctx.err = stderr;
+
+    double cold_secs = time_cached_compile(&ctx, fname, false);
+    double front_secs = unit_stats.wall_secs[stats_parse]
+	+ unit_stats.wall_secs[stats_scope];
+    double store_secs = unit_stats.wall_secs[stats_cache];
+    unsigned long nodes = 0;
+    for (unsigned int a = 0; a <= number_ast; a++) {
+	nodes += unit_stats.nodes[a];
+    }
+    double hot_secs = time_cached_compile(&ctx, fname, true);
+    double load_secs = unit_stats.wall_secs[stats_cache];
+
+    printf("%-24s %10lld %10lu %9.1f %9.1f %9.1f %9.1f %9.1f %8.1fx\n",
+	   fname, (long long) st.st_size, nodes,
+	   1000 * cold_secs, 1000 * front_secs, 1000 * store_secs,
+	   1000 * hot_secs, 1000 * load_secs, cold_secs / hot_secs);
+    fflush(stdout);
+}
+
+// Return the text of the file named fname (malloc-ed), setting *len
+static char *read_file(const char *fname, size_t *len)
+{
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL) {
+	bail_with_error("Cannot open %s", fname);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = (size_t) ftell(f);
+    rewind(f);
+    char *ret = (char *) malloc(*len + 1);
+    if (ret == NULL || fread(ret, 1, *len, f) != *len) {
+	bail_with_error("Cannot read %s", fname);
+    }
+    ret[*len] = '\0';
+    fclose(f);
+    return ret;
+}
+
+// Return the unparsed text of prog (malloc-ed)
+static char *unparsed(AST *prog)
+{
+    char *ret;
+    size_t len;
+    FILE *f = open_memstream(&ret, &len);
+    unparseProgram(f, prog);
+    fclose(f);
+    return ret;
+}
+
+// Return the offset of the first char at or after pos in the len chars
+// at text (cyclically) for which ok is true
+static size_t find_from(const char *text, size_t len, size_t pos,
+			bool (*ok)(const char *text, size_t i))
+{
+    for (size_t n = 0; n < len; n++) {
+	size_t i = (pos + n) % len;
+	if (ok(text, i)) {
+	    return i;
+	}
+    }
+    bail_with_error("Nowhere to edit in a text of %zu chars", len);
+    return 0;
+}
+
+// Is text[i] a digit of a number (or name) that changing
+// cannot make too large (so one of fewer than 5 digits)?
+// (text is null-terminated, see read_file)
+static bool changeable_digit(const char *text, size_t i)
+{
+    if (!isdigit((unsigned char) text[i])) {
+	return false;
+    }
+    size_t first = i, last = i;
+    while (first > 0 && isdigit((unsigned char) text[first - 1])) {
+	first--;
+    }
+    while (isdigit((unsigned char) text[last + 1])) {
+	last++;
+    }
+    return last - first + 1 < 5;
+}
+
+// Is text[i] white space?
+static bool white_space(const char *text, size_t i)
+{
+    return isspace((unsigned char) text[i]);
+}
+
+// Compare two doubles for qsort
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Print one line of measurements of making the given number of
+// single char edits in an edit session on the file named fname on stdout
+static void bench_edited_file(const char *fname, unsigned int edits)
+{
+    size_t len;
+    char *text = read_file(fname, &len);
+    double start = now();
+    if (!reparse_open(fname)) {
+	bail_with_error("%s does not parse", fname);
+    }
+    double open_secs = now() - start;
+    stats_reset();
+
+    double *secs = (double *) malloc(edits * sizeof(double));
+    if (secs == NULL) {
+	bail_with_error("No space for the times of %u edits", edits);
+    }
+    uint64_t rand_state = 88172645463325252ULL;
+    size_t pos = 0, space = 0;
+    for (unsigned int e = 0; e < edits; e++) {
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 7;
+	rand_state ^= rand_state << 17;
+	// like an editor's cursor, mostly near the last edit
+	pos = (e % 64 == 0) ? rand_state % len
+	    : (pos + len - 1000 + rand_state % 2001) % len;
+	size_t from, to, n = 1;
+	const char *chars;
+	switch (e % 3) {
+	case 0:
+	    from = find_from(text, len, pos, changeable_digit);
+	    to = from + 1;
+	    text[from] = (char) ('0' + ((text[from] - '0') ^ 1));
+	    chars = &text[from];
+	    break;
+	case 1:
+	    space = from = to = find_from(text, len, pos, white_space);
+	    chars = " ";
+	    break;
+	default:
+	    from = space;
+	    to = space + 1;
+	    chars = "";
+	    n = 0;
+	    break;
+	}
+	start = now();
+	bool parses = reparse_edit(from, to, chars, n);
+	secs[e] = now() - start;
+	if (!parses) {
+	    bail_with_error("Edit %u of %s does not parse", e + 1, fname);
+	}
+    }
+    if (edits % 3 == 2) {
+	// so the text is as edited (without the space inserted last)
+	reparse_edit(space, space + 1, "", 0);
+    }
+
+    start = now();
+    AST *prog = reparse_program();
+    double refresh_secs = now() - start;
+    char *got = unparsed(prog);
+
+    // the text as edited, parsed afresh, should give the same program
+    char tmpname[] = "/tmp/pl0bench-XXXXXX";
+    int fd = mkstemp(tmpname);
+    FILE *f = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if (f == NULL || fwrite(text, 1, len, f) != len || fclose(f) != 0) {
+	bail_with_error("Cannot write %s", tmpname);
+    }
+    reparse_close();
+    lexer_release();
+    parser_open(tmpname);
+    char *expected = unparsed(parseProgram());
+    parser_close();
+    remove(tmpname);
+    if (strcmp(got, expected) != 0) {
+	bail_with_error("Edited %s is not the program its text parses as",
+			fname);
+    }
+
+    qsort(secs, edits, sizeof(double), compare_doubles);
+    printf("%-24s %10zu %10u %9.1f %9.1f %9.1f %10.1f %9lu %9.1f\n",
+	   fname, len, edits, 1000 * open_secs,
+	   1e6 * secs[edits / 2], 1e6 * secs[edits - 1],
+	   (double) unit_stats.reparse_chars / edits,
+	   unit_stats.reparse_wholes, 1000 * refresh_secs);
+    fflush(stdout);
+
+    free(got);
+    free(expected);
+    free(secs);
+    free(text);
+    ast_arena_release();
+    lexer_release();
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2) {
+	fprintf(stderr, "Usage: %s [-h] [-C cache-dir | -E edits]"
+		" code-filename...\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    FILE *devnull = fopen("/dev/null", "w");
+    if (devnull == NULL) {
+	bail_with_error("Cannot open /dev/null");
+    }
+    int first = 1;
+    bool headings = false;
+    const char *cache_dir = NULL;
+    unsigned int edits = 0;
+    if (strcmp(argv[first], "-h") == 0) {
+	headings = true;
+	first++;
+    }
+    if (first + 1 < argc && strcmp(argv[first], "-C") == 0) {
+	cache_dir = argv[first + 1];
+	first += 2;
+    } else if (first + 1 < argc && strcmp(argv[first], "-E") == 0) {
+	edits = (unsigned int) atoi(argv[first + 1]);
+	if (edits == 0) {
+	    bail_with_error("The number of edits must be positive");
+	}
+	first += 2;
+    }
+    if (headings && edits > 0) {
+	printf("%-24s %10s %10s %9s %9s %9s %10s %9s %9s\n",
+	       "file", "bytes", "edits", "open ms", "median us", "max us",
+	       "chars/edit", "wholes", "refresh ms");
+    } else if (headings && cache_dir != NULL) {
+	printf("%-24s %10s %10s %9s %9s %9s %9s %9s %9s\n",
+	       "file", "bytes", "nodes", "cold ms", "front ms", "store ms",
+	       "hot ms", "load ms", "speedup");
+    } else if (headings) {
+	printf("%-24s %10s %10s %10s"
+	       " %8s %8s %8s %8s %8s %8s %8s %8s %9s\n",
+	       "file", "bytes", "tokens", "nodes",
+	       "lex ms", "Mtok/s", "parse ms", "Mtok/s",
+	       "scope ms", "Mnode/s", "unpar ms", "Mnode/s", "peak KB");
+    }
+    for (int i = first; i < argc; i++) {
+	if (edits > 0) {
+	    bench_edited_file(argv[i], edits);
+	} else if (cache_dir != NULL) {
+	    bench_cached_file(argv[i], cache_dir, devnull);
+	} else {
+	    bench_file(argv[i], devnull);
+	}
+    }
+    fclose(devnull);
+    return EXIT_SUCCESS;
+}
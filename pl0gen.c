@@ -0,0 +1,365 @@
+// Generator of synthetic (but valid) PL/0 programs for benchmarking:
+// writes on stdout a program of about the given size whose bulk
+// has the given shape (see usage below and the bench target in the Makefile).
+// The same size, shape, and seed always give the same program.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+// The limits on how deep the generated programs nest,
+// which keep the (recursive) parser, scope checker and unparser
+// well within their stack, however large the program is
+#define MAX_BEGIN_DEPTH 64
+#define MAX_EXPR_TERMS 64
+#define MAX_CASCADE_LENGTH 32
+
+// The number of consts and vars declared, when the shape is not decls
+#define NUM_BODY_IDENTS 100
+
+// The shapes of programs, and their names (in the same order)
+typedef enum { mixed, decls, nesting, exprs, cascades } shape_kind;
+static const char *shape_names[] = {
+    "mixed", "decls", "nesting", "exprs", "cascades"
+};
+#define NUM_SHAPES (sizeof(shape_names) / sizeof(shape_names[0]))
+
+// The number of chars written on stdout so far
+static unsigned long long written = 0;
+
+// The state of the pseudo-random number generator (xorshift64)
+static uint64_t rng_state;
+
+// The numbers of consts and vars declared (named cN and vN)
+static unsigned long num_consts, num_vars;
+
+static void usage(const char *cmdname)
+{
+    fprintf(stderr,
+	    "Usage: %s size [shape [seed]]\n"
+	    "  size is in bytes, and may end with K or M (for 1024 or 1024*1024)\n"
+	    "  shape is one of mixed (the default), decls, nesting, exprs,"
+	    " or cascades\n",
+	    cmdname);
+    exit(EXIT_FAILURE);
+}
+
+// Return the next pseudo-random number
+static uint64_t rng_next()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Requires: n > 0
+// Return a pseudo-random number in [0, n)
+static unsigned long rng_below(unsigned long n)
+{
+    return (unsigned long) (rng_next() % n);
+}
+
+// Write the string s on stdout (counting its chars)
+static void emit(const char *s)
+{
+    size_t len = strlen(s);
+    fwrite(s, 1, len, stdout);
+    written += len;
+}
+
+// Write n spaces on stdout (as indentation)
+static void emit_indent(unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++) {
+	putchar(' ');
+    }
+    written += n;
+}
+
+// Write an identifier of the kind given (by prefix 'c' or 'v')
+// with the given number
+static void emit_ident(char prefix, unsigned long num)
+{
+    char buf[32];
+    sprintf(buf, "%c%lu", prefix, num);
+    emit(buf);
+}
+
+// Write a (non-negative) number that fits in a short
+static void emit_number(unsigned int max)
+{
+    char buf[16];
+    sprintf(buf, "%lu", rng_below(max));
+    emit(buf);
+}
+
+// Write a factor: a declared identifier, a number, or
+// (with depth left) a parenthesized expression
+static void emit_expr(unsigned int terms, unsigned int depth);
+static void emit_factor(unsigned int depth)
+{
+    switch (rng_below(depth > 0 ? 5 : 4)) {
+    case 0:
+	emit_ident('c', rng_below(num_consts));
+	break;
+    case 1:
+    case 2:
+	emit_ident('v', rng_below(num_vars));
+	break;
+    case 3:
+	emit_number(1000);
+	break;
+    default:
+	emit("(");
+	emit_expr(1 + rng_below(4), depth - 1);
+	emit(")");
+	break;
+    }
+}
+
+// Write an expression of the given number of terms (at least 1)
+// whose parenthesized subexpressions nest at most depth deep.
+// Divisions are only by (non-zero) numbers.
+static void emit_expr(unsigned int terms, unsigned int depth)
+{
+    emit_factor(depth);
+    for (unsigned int i = 1; i < terms; i++) {
+	switch (rng_below(4)) {
+	case 0:
+	    emit(" + ");
+	    emit_factor(depth);
+	    break;
+	case 1:
+	    emit(" - ");
+	    emit_factor(depth);
+	    break;
+	case 2:
+	    emit(" * ");
+	    emit_factor(depth);
+	    break;
+	default:
+	    emit(" / ");
+	    char buf[16];
+	    sprintf(buf, "%lu", 1 + rng_below(99));
+	    emit(buf);
+	    break;
+	}
+    }
+}
+
+// Write a condition
+static void emit_cond()
+{
+    static const char *rel_ops[] = { " = ", " <> ", " < ", " <= ", " > ", " >= " };
+    if (rng_below(6) == 0) {
+	emit("odd ");
+	emit_expr(1 + rng_below(3), 1);
+    } else {
+	emit_expr(1 + rng_below(3), 1);
+	emit(rel_ops[rng_below(6)]);
+	emit_expr(1 + rng_below(3), 1);
+    }
+}
+
+// Write a simple statement (an assignment, read, write, or skip)
+// with expressions of about the given number of terms
+static void emit_simple_stmt(unsigned int indent, unsigned int terms)
+{
+    emit_indent(indent);
+    switch (rng_below(8)) {
+    case 0:
+	emit("read ");
+	emit_ident('v', rng_below(num_vars));
+	break;
+    case 1:
+	emit("write ");
+	emit_expr(1 + rng_below(terms), 2);
+	break;
+    case 2:
+	emit("skip");
+	break;
+    default:
+	emit_ident('v', rng_below(num_vars));
+	emit(" := ");
+	emit_expr(1 + rng_below(terms), 2);
+	break;
+    }
+}
+
+// Write a begin statement whose begins nest depth deep,
+// with a few simple statements at each level
+static void emit_nested_begins(unsigned int indent, unsigned int depth)
+{
+    emit_indent(indent);
+    emit("begin\n");
+    unsigned int n = 1 + rng_below(3);
+    for (unsigned int i = 0; i < n; i++) {
+	emit_simple_stmt(indent + 2, 4);
+	emit(";\n");
+    }
+    if (depth > 1) {
+	emit_nested_begins(indent + 2, depth - 1);
+    } else {
+	emit_simple_stmt(indent + 2, 4);
+    }
+    emit("\n");
+    emit_indent(indent);
+    emit("end");
+}
+
+// Write a cascade of length ifs (if ... then ... else if ...)
+// or whiles (while ... do while ...)
+static void emit_cascade(unsigned int indent, unsigned int length)
+{
+    emit_indent(indent);
+    if (rng_below(3) == 0) {
+	for (unsigned int i = 0; i < length; i++) {
+	    emit("while ");
+	    emit_cond();
+	    emit(" do\n");
+	    emit_indent(indent + 2 * (i + 1));
+	}
+	emit_ident('v', rng_below(num_vars));
+	emit(" := 0");
+	return;
+    }
+    for (unsigned int i = 0; i < length; i++) {
+	emit("if ");
+	emit_cond();
+	emit(" then\n");
+	emit_simple_stmt(indent + 2, 4);
+	emit("\n");
+	emit_indent(indent);
+	emit("else ");
+    }
+    emit("skip");
+}
+
+// Return the smaller of limit and 1 more than the number of
+// (about per_item byte) items that fit in what is left of size bytes,
+// so that small programs are not overshot by a single big statement
+static unsigned long fitting(unsigned long long size, unsigned long limit,
+			     unsigned long per_item)
+{
+    unsigned long long left = (written < size) ? size - written : 0;
+    unsigned long long n = left / per_item + 1;
+    return (n < limit) ? (unsigned long) n : limit;
+}
+
+// Write one statement of the body, of the given shape,
+// for a program of about size bytes
+static void emit_body_stmt(shape_kind shape, unsigned long long size)
+{
+    if (shape == mixed) {
+	shape = (shape_kind) (decls + 1 + rng_below(3));
+	if (rng_below(2) == 0) {
+	    emit_simple_stmt(2, 8);
+	    return;
+	}
+    }
+    switch (shape) {
+    case nesting:
+	emit_nested_begins(2, 1 + rng_below(fitting(size, MAX_BEGIN_DEPTH, 200)));
+	break;
+    case exprs:
+	emit_indent(2);
+	emit_ident('v', rng_below(num_vars));
+	emit(" := ");
+	emit_expr(1 + rng_below(fitting(size, MAX_EXPR_TERMS, 6)), 3);
+	break;
+    case cascades:
+	emit_cascade(2, 1 + rng_below(fitting(size, MAX_CASCADE_LENGTH, 80)));
+	break;
+    default:
+	emit_simple_stmt(2, 4);
+	break;
+    }
+}
+
+// Write declarations of num consts or vars (by kind 'c' or 'v'),
+// several to a line
+static void emit_decls(char kind, unsigned long num)
+{
+    for (unsigned long i = 0; i < num; i += 10) {
+	emit(kind == 'c' ? "const " : "var ");
+	for (unsigned long j = i; j < num && j < i + 10; j++) {
+	    if (j > i) {
+		emit(", ");
+	    }
+	    emit_ident(kind, j);
+	    if (kind == 'c') {
+		emit(" = ");
+		emit_number(32768);
+	    }
+	}
+	emit(";\n");
+    }
+}
+
+// Return the size in bytes that s denotes (see usage),
+// or 0 if it does not denote a size
+static unsigned long long parse_size(const char *s)
+{
+    char *end;
+    unsigned long long n = strtoull(s, &end, 10);
+    if (end == s) {
+	return 0;
+    }
+    if (*end == 'K' || *end == 'k') {
+	n *= 1024;
+	end++;
+    } else if (*end == 'M' || *end == 'm') {
+	n *= 1024 * 1024;
+	end++;
+    }
+    return (*end == '\0') ? n : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 4) {
+	usage(argv[0]);
+    }
+    unsigned long long size = parse_size(argv[1]);
+    if (size == 0) {
+	usage(argv[0]);
+    }
+    shape_kind shape = mixed;
+    if (argc > 2) {
+	unsigned int i = 0;
+	while (i < NUM_SHAPES && strcmp(argv[2], shape_names[i]) != 0) {
+	    i++;
+	}
+	if (i == NUM_SHAPES) {
+	    usage(argv[0]);
+	}
+	shape = (shape_kind) i;
+    }
+    rng_state = (argc > 3) ? strtoull(argv[3], NULL, 10) : 0;
+    // xorshift needs a non-zero state
+    rng_state = rng_state * 2654435761u + 88172645463325252u;
+
+    char header[80];
+    sprintf(header, "# synthetic %s program of about %llu bytes\n",
+	    shape_names[shape], size);
+    emit(header);
+    if (shape == decls) {
+	// each declaration takes about 12 chars, half of them consts
+	num_consts = size / 24 + 1;
+	num_vars = size / 24 + 1;
+    } else {
+	// but not so many that the declarations are most of a small program
+	num_consts = fitting(size, NUM_BODY_IDENTS, 100);
+	num_vars = num_consts;
+    }
+    emit_decls('c', num_consts);
+    emit_decls('v', num_vars);
+    emit("begin\n");
+    do {
+	emit_body_stmt(shape, size);
+	emit(";\n");
+    } while (written < size);
+    emit("  skip\nend.\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,24 @@
+// Runtime support for programs compiled to native code (see gen_asm.h)
+#include <stdio.h>
+#include <stdlib.h>
+
+// Write the character c to stdout
+void pl0_write(int c)
+{
+    putchar(c);
+}
+
+// Return the next character read from stdin (-1 at EOF)
+int pl0_read()
+{
+    return getchar();
+}
+
+// Report a division by zero at the given location in filename and exit
+void pl0_div_by_zero(const char *filename, int line, int column)
+{
+    fflush(stdout);
+    fprintf(stderr, "%s: line %d, column %d: division by zero\n",
+	    filename, line, column);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,958 @@
+// Incremental parsing of a file being edited (see reparse.h)
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <setjmp.h>
+#include "utilities.h"
+#include "file_location.h"
+#include "lexer.h"
+#include "parser_api.h"
+#include "tokstream.h"
+#include "stats.h"
+#include "reparse.h"
+
+// The least room left for insertions when the text grows
+#define MIN_GAP 4096
+
+// The length of the reserved word begin, after which the first
+// statement of a begin statement can be parsed again on its own
+#define BEGIN_LEN 5
+
+// A statement of the program, in the index of the statements by offset:
+// a treap (ordered by the statements' starts, and a heap by priority)
+// in which shifting the offsets of all of a subtree is put off
+// by adding the shift to its root, until the subtree is taken apart
+typedef struct stmt_entry_s stmt_entry;
+struct stmt_entry_s {
+    AST *stmt;
+    stmt_entry *parent; // the entry of the statement around this one
+    // the offsets of the statement's first token and of the token after it,
+    // not counting the shifts of the entries above (see entry_start)
+    long long start;
+    long long follow;
+    long long shift; // to add to the offsets of all of this subtree
+    stmt_entry *left, *right, *up;
+    uint32_t priority;
+};
+
+// A statement parsed, and the offset of the token after it
+typedef struct {
+    AST *stmt;
+    unsigned int follow;
+} stmt_record;
+
+// The parts of the program that an edit may parse again
+typedef enum {
+    part_statement, part_statements, part_declarations, part_end, part_program
+} part_kind;
+
+static const char *part_names[] = {
+    "a statement", "statements of a begin", "the declarations",
+    "the end of the program", "the whole program"
+};
+
+// The session of the calling thread (see reparse.h)
+static _Thread_local struct {
+    bool open;
+    const char *fname;
+    unsigned int file; // the text's id (see file_location.h)
+    // the text, with a gap of gap_len chars at the offset gap_start
+    char *buf;
+    size_t cap;
+    size_t gap_start;
+    size_t gap_len;
+    // the AST of the text when it last parsed (NULL if it has not
+    // since the last try to parse it as a whole),
+    // and the index of its statements
+    AST *prog;
+    stmt_entry *root;
+    stmt_entry *main; // the entry of prog's statement
+    // does the text parse now?  If not, the part changed since it last
+    // did is from dirty_start to dirty_end (in the text then),
+    // which is now delta chars longer
+    bool parses;
+    unsigned int dirty_start;
+    unsigned int dirty_end;
+    long long delta;
+    bool stale; // are some file locations in prog out of date?
+    size_t reparsed; // chars parsed since the text was last parsed whole
+    // the statements parsed by the current try, in the order they end
+    stmt_record *records;
+    size_t num_records;
+    size_t records_cap;
+    // entries made for them (by make_entries), in order of their starts,
+    // the outermost of those, in order, and room for build_treap
+    stmt_entry **entries;
+    stmt_entry **tops;
+    stmt_entry **spine;
+    size_t num_entries;
+    size_t num_tops;
+    size_t entries_cap;
+    // where the current try started parsing
+    size_t parse_start;
+    // what the last edit parsed again (the last part tried, and the
+    // chars parsed by all tries)
+    part_kind last_part;
+    size_t last_len;
+    // the replacement text of the edit read last by reparse_edit_file
+    char *edit_text;
+    size_t edit_cap;
+    uint64_t rng; // for the priorities of entries (xorshift64)
+} session;
+
+// ---------- THE TEXT ----------
+
+// Return the length of the session's text
+static inline size_t text_len()
+{
+    return session.cap - session.gap_len;
+}
+
+// Tell file_location where the text is now
+static void text_moved()
+{
+    file_location_set_text(session.file, session.buf, session.gap_start,
+			   session.buf + session.gap_start + session.gap_len,
+			   text_len());
+}
+
+// Move the gap to the offset pos of the text
+static void move_gap(size_t pos)
+{
+    if (pos < session.gap_start) {
+	memmove(session.buf + pos + session.gap_len, session.buf + pos,
+		session.gap_start - pos);
+    } else if (pos > session.gap_start) {
+	memmove(session.buf + session.gap_start,
+		session.buf + session.gap_start + session.gap_len,
+		pos - session.gap_start);
+    }
+    session.gap_start = pos;
+    text_moved();
+}
+
+// Return (a pointer to) the text from the offset pos on,
+// moving the gap out of the way (to pos, or to the end if that is nearer)
+static const char *text_from(size_t pos)
+{
+    if (session.gap_start > pos && session.gap_start < text_len()) {
+	if (session.gap_start - pos <= text_len() - session.gap_start) {
+	    move_gap(pos);
+	} else {
+	    move_gap(text_len());
+	}
+    }
+    if (session.gap_start <= pos) {
+	return session.buf + session.gap_len + pos;
+    }
+    return session.buf + pos;
+}
+
+// Requires: start <= end <= text_len()
+// Replace the chars of the text from start to end by the len chars at text
+static void text_replace(size_t start, size_t end, const char *text,
+			 size_t len)
+{
+    move_gap(start);
+    session.gap_len += end - start;
+    if (session.gap_len < len) {
+	// grow by half again, so growing takes constant time per char
+	size_t after = session.cap - session.gap_start - session.gap_len;
+	size_t cap = session.cap + (len - session.gap_len)
+	    + session.cap / 2 + MIN_GAP;
+	char *buf = (char *) realloc(session.buf, cap);
+	if (buf == NULL) {
+	    bail_with_error("No space for the text of %s!", session.fname);
+	}
+	memmove(buf + cap - after, buf + session.gap_start + session.gap_len,
+		after);
+	session.buf = buf;
+	session.gap_len += cap - session.cap;
+	session.cap = cap;
+    }
+    memcpy(session.buf + session.gap_start, text, len);
+    session.gap_start += len;
+    session.gap_len -= len;
+    text_moved();
+}
+
+// ---------- THE INDEX OF STATEMENTS ----------
+
+// Return a pseudo-random priority for an entry
+static uint32_t next_priority()
+{
+    session.rng ^= session.rng << 13;
+    session.rng ^= session.rng >> 7;
+    session.rng ^= session.rng << 17;
+    return (uint32_t) (session.rng >> 32);
+}
+
+// Apply the shift of e to its own offsets, passing it on to its subtrees
+static inline void push_shift(stmt_entry *e)
+{
+    if (e->shift != 0) {
+	e->start += e->shift;
+	e->follow += e->shift;
+	if (e->left != NULL) {
+	    e->left->shift += e->shift;
+	}
+	if (e->right != NULL) {
+	    e->right->shift += e->shift;
+	}
+	e->shift = 0;
+    }
+}
+
+// Return the sum of the shifts of e and the entries above it
+static long long shifts_above(const stmt_entry *e)
+{
+    long long ret = 0;
+    for (; e != NULL; e = e->up) {
+	ret += e->shift;
+    }
+    return ret;
+}
+
+// Return the offset of the first token of e's statement
+static inline long long entry_start(const stmt_entry *e)
+{
+    return e->start + shifts_above(e);
+}
+
+// Return the offset of the token after e's statement
+static inline long long entry_follow(const stmt_entry *e)
+{
+    return e->follow + shifts_above(e);
+}
+
+// Split the treap t into *l, those of its entries starting before key,
+// and *r, the rest
+static void split(stmt_entry *t, long long key, stmt_entry **l,
+		  stmt_entry **r)
+{
+    if (t == NULL) {
+	*l = *r = NULL;
+	return;
+    }
+    push_shift(t);
+    t->up = NULL;
+    if (t->start < key) {
+	split(t->right, key, &t->right, r);
+	if (t->right != NULL) {
+	    t->right->up = t;
+	}
+	*l = t;
+    } else {
+	split(t->left, key, l, &t->left);
+	if (t->left != NULL) {
+	    t->left->up = t;
+	}
+	*r = t;
+    }
+}
+
+// Requires: all the entries of l start before all those of r
+// Return the treap of the entries of both l and r
+static stmt_entry *merge(stmt_entry *l, stmt_entry *r)
+{
+    if (l == NULL) {
+	return r;
+    } else if (r == NULL) {
+	return l;
+    }
+    if (l->priority > r->priority) {
+	push_shift(l);
+	l->right = merge(l->right, r);
+	l->right->up = l;
+	return l;
+    }
+    push_shift(r);
+    r->left = merge(l, r->left);
+    r->left->up = r;
+    return r;
+}
+
+// Return the last entry starting at or before pos, or NULL if none does
+static stmt_entry *entry_at_or_before(long long pos)
+{
+    stmt_entry *ret = NULL;
+    for (stmt_entry *e = session.root; e != NULL; ) {
+	push_shift(e);
+	if (e->start <= pos) {
+	    ret = e;
+	    e = e->right;
+	} else {
+	    e = e->left;
+	}
+    }
+    return ret;
+}
+
+// Return the first entry starting at or after pos, or NULL if none does
+static stmt_entry *entry_at_or_after(long long pos)
+{
+    stmt_entry *ret = NULL;
+    for (stmt_entry *e = session.root; e != NULL; ) {
+	push_shift(e);
+	if (e->start >= pos) {
+	    ret = e;
+	    e = e->left;
+	} else {
+	    e = e->right;
+	}
+    }
+    return ret;
+}
+
+// Requires: e's statement is in the begin statement of b
+// Return the entry of the statement after e's in b's, or NULL if none
+static stmt_entry *next_in_begin(stmt_entry *e, stmt_entry *b)
+{
+    stmt_entry *next = entry_at_or_after(entry_follow(e));
+    return (next != NULL && next->parent == b) ? next : NULL;
+}
+
+// Give back all the entries of the treap t
+static void free_entries(stmt_entry *t)
+{
+    while (t != NULL) {
+	free_entries(t->left);
+	stmt_entry *right = t->right;
+	free(t);
+	t = right;
+    }
+}
+
+// Compare the starts of the entries at a and b (for qsort)
+static int compare_starts(const void *a, const void *b)
+{
+    long long sa = (*(stmt_entry * const *) a)->start;
+    long long sb = (*(stmt_entry * const *) b)->start;
+    return (sa > sb) - (sa < sb);
+}
+
+// Make entries for the statements recorded by the current try,
+// the outermost of which are in the statement of the entry parent
+// (NULL for the program's), leaving them in order of their starts in
+// session.entries, and the outermost ones (in order) in session.tops
+static void make_entries(stmt_entry *parent)
+{
+    size_t n = session.num_records;
+    if (n > session.entries_cap) {
+	free(session.entries);
+	free(session.tops);
+	free(session.spine);
+	session.entries = (stmt_entry **) malloc(n * sizeof(stmt_entry *));
+	session.tops = (stmt_entry **) malloc(n * sizeof(stmt_entry *));
+	session.spine = (stmt_entry **) malloc(n * sizeof(stmt_entry *));
+	if (session.entries == NULL || session.tops == NULL
+	    || session.spine == NULL) {
+	    bail_with_error("No space for the statements of %s!",
+			    session.fname);
+	}
+	session.entries_cap = n;
+    }
+    session.num_tops = 0;
+    for (size_t i = 0; i < n; i++) {
+	stmt_entry *e = (stmt_entry *) malloc(sizeof(stmt_entry));
+	if (e == NULL) {
+	    bail_with_error("No space for the statements of %s!",
+			    session.fname);
+	}
+	e->stmt = session.records[i].stmt;
+	e->parent = parent;
+	e->start = e->stmt->file_loc.offset;
+	e->follow = session.records[i].follow;
+	e->shift = 0;
+	e->left = e->right = e->up = NULL;
+	e->priority = next_priority();
+	// each statement is recorded after those in it,
+	// which are the ones without a parent yet that start after it
+	while (session.num_tops > 0
+	       && session.tops[session.num_tops - 1]->start > e->start) {
+	    session.tops[--session.num_tops]->parent = e;
+	}
+	session.tops[session.num_tops++] = e;
+	session.entries[i] = e;
+    }
+    session.num_entries = n;
+    qsort(session.entries, n, sizeof(stmt_entry *), compare_starts);
+}
+
+// Return a treap of the entries made by make_entries
+// (built in linear time, along its right spine)
+static stmt_entry *build_treap()
+{
+    size_t depth = 0;
+    for (size_t i = 0; i < session.num_entries; i++) {
+	stmt_entry *e = session.entries[i];
+	stmt_entry *last = NULL;
+	while (depth > 0 && session.spine[depth - 1]->priority < e->priority) {
+	    last = session.spine[--depth];
+	}
+	e->left = last;
+	if (last != NULL) {
+	    last->up = e;
+	}
+	if (depth > 0) {
+	    session.spine[depth - 1]->right = e;
+	    e->up = session.spine[depth - 1];
+	}
+	session.spine[depth++] = e;
+    }
+    return (depth > 0) ? session.spine[0] : NULL;
+}
+
+// Replace the entries starting from lo up to hi (before the edit)
+// by those made by make_entries, and shift those after them by the edit
+static void replace_entries(long long lo, long long hi)
+{
+    stmt_entry *left, *mid, *right;
+    split(session.root, lo, &left, &mid);
+    split(mid, hi, &mid, &right);
+    free_entries(mid);
+    if (right != NULL) {
+	right->shift += session.delta;
+    }
+    session.root = merge(merge(left, build_treap()), right);
+}
+
+// Move the follows of e and the entries of the statements around it
+// by the edit (which is in all of them)
+static void shift_follows(stmt_entry *e)
+{
+    for (; e != NULL; e = e->parent) {
+	e->follow += session.delta;
+    }
+}
+
+// ---------- PARSING PARTS OF THE TEXT AGAIN ----------
+
+// Record that the current try parsed stmt, followed by the token follow
+static void record_stmt(AST *stmt, token follow)
+{
+    if (session.num_records == session.records_cap) {
+	session.records_cap = (session.records_cap == 0)
+	    ? 256 : 2 * session.records_cap;
+	session.records = (stmt_record *) realloc(session.records,
+			      session.records_cap * sizeof(stmt_record));
+	if (session.records == NULL) {
+	    bail_with_error("No space for the statements of %s!",
+			    session.fname);
+	}
+    }
+    session.records[session.num_records].stmt = stmt;
+    session.records[session.num_records].follow = follow.offset;
+    session.num_records++;
+}
+
+// Start a try of parsing the part given of the text, from pos on
+static void parse_from(part_kind part, size_t pos)
+{
+    session.last_part = part;
+    session.num_records = 0;
+    session.parse_start = pos;
+    const char *text = text_from(pos);
+    parser_set_stmt_listener(record_stmt);
+    parser_open_text(session.fname, session.file, text, text_len() - pos,
+		     (unsigned int) pos);
+}
+
+// Finish the current try (even if it stopped at an error),
+// counting the chars it parsed
+static void parse_done()
+{
+    parser_set_stmt_listener(NULL);
+    unsigned int end = parser_token().offset;
+    size_t len = (end > session.parse_start) ? end - session.parse_start : 0;
+    session.last_len += len;
+    session.reparsed += len;
+    unit_stats.reparse_chars += len;
+    if (!lexer_done()) {
+	parser_close();
+    }
+}
+
+// Is the parser's lookahead the token that was at the offset follow
+// before the edit (which is after the edit), so what was parsed
+// is followed by what followed the part it replaces?
+static bool follows_as_before(long long follow)
+{
+    return parser_token().offset == follow + session.delta;
+}
+
+// Replace the AST old by the first of the outermost statements parsed
+// (in place, so whatever refers to old refers to that instead),
+// returning it
+static AST *take_place_of(AST *old)
+{
+    AST_list next = old->next;
+    *old = *session.tops[0]->stmt;
+    old->next = next;
+    session.tops[0]->stmt = old;
+    return old;
+}
+
+// Forget the AST and the index of its statements
+static void forget_program()
+{
+    free_entries(session.root);
+    session.root = NULL;
+    session.main = NULL;
+    session.prog = NULL;
+}
+
+// Parse the whole text (giving back all the ASTs made so far first)
+static void parse_whole()
+{
+    forget_program();
+    ast_arena_release();
+    unit_stats.reparse_wholes++;
+    parse_from(part_program, 0);
+    AST *prog = parseProgram();
+    parse_done();
+    session.reparsed = 0;
+    make_entries(NULL);
+    session.root = build_treap();
+    session.main = session.tops[0];
+    session.prog = prog;
+    session.stale = false;
+}
+
+// Parse the declarations again (as the edit is before the program's
+// statement), returning whether they end where they did
+static bool reparse_declarations()
+{
+    long long main_start = entry_start(session.main);
+    parse_from(part_declarations, 0);
+    AST_list cds = parseConsts();
+    AST_list vds = parseVars();
+    bool fits = follows_as_before(main_start);
+    parse_done();
+    if (!fits) {
+	return false;
+    }
+    session.prog->data.program.cds = cds;
+    session.prog->data.program.vds = vds;
+    session.root->shift += session.delta;
+    return true;
+}
+
+// Parse the end of the program again (as the edit is after its statement)
+static void reparse_end()
+{
+    parse_from(part_end, entry_follow(session.main));
+    eat(periodsym);
+    eat(eofsym);
+    parse_done();
+}
+
+// Requires: c is not session.main
+// Parse the statement of c again (as the edit is in it),
+// returning whether it fits where it was (and so replaces it)
+static bool reparse_statement(stmt_entry *c)
+{
+    long long start = entry_start(c);
+    long long follow = entry_follow(c);
+    parse_from(part_statement, start);
+    parseStmt();
+    bool fits = follows_as_before(follow);
+    parse_done();
+    if (!fits) {
+	return false;
+    }
+    make_entries(c->parent);
+    take_place_of(c->stmt);
+    shift_follows(c->parent);
+    replace_entries(start, follow);
+    return true;
+}
+
+// Requires: b's statement is a begin statement, and the edit is in it
+//           after its reserved word begin
+// Parse again the statements of b's statement, from the last one
+// starting at or before the edit (or the first) up to the first one
+// after the edit that starts where it did (or to the end of b's),
+// returning whether they fit where they were (and so replace them)
+static bool reparse_statements(stmt_entry *b)
+{
+    stmt_entry *first = entry_at_or_before(session.dirty_start);
+    while (first != b && first->parent != b) {
+	first = first->parent;
+    }
+    long long from;
+    if (first == b) {
+	// the edit is before the first statement
+	from = entry_start(b) + BEGIN_LEN;
+	first = entry_at_or_after(entry_start(b) + 1);
+    } else {
+	from = entry_start(first);
+    }
+    // the statements after first's that start after the edit are
+    // parsed as before, once parsing gets to the start of one
+    stmt_entry *next = next_in_begin(first, b);
+    while (next != NULL && entry_start(next) < session.dirty_end) {
+	next = next_in_begin(next, b);
+    }
+
+    parse_from(part_statements, from);
+    parseStmt();
+    bool fits = false;
+    while (!fits && parser_token().typ == semisym) {
+	eat(semisym);
+	long long at = parser_token().offset - session.delta;
+	while (next != NULL && entry_start(next) < at) {
+	    next = next_in_begin(next, b);
+	}
+	if (next != NULL && entry_start(next) == at) {
+	    fits = true;
+	} else {
+	    parseStmt();
+	}
+    }
+    long long follow = entry_follow(b);
+    if (!fits) {
+	eat(endsym);
+	fits = follows_as_before(follow);
+	next = NULL;
+    }
+    parse_done();
+    if (!fits) {
+	return false;
+    }
+
+    long long lo = entry_start(first);
+    long long hi = (next != NULL) ? entry_start(next) : follow;
+    make_entries(b);
+    AST *last = take_place_of(first->stmt);
+    for (size_t i = 1; i < session.num_tops; i++) {
+	last->next = session.tops[i]->stmt;
+	last = last->next;
+    }
+    last->next = (next != NULL) ? next->stmt : NULL;
+    shift_follows(b);
+    replace_entries(lo, hi);
+    return true;
+}
+
+// Parse again the part of the text changed since it last parsed,
+// or the whole text if there is no AST to change
+static void reparse_changed()
+{
+    if (session.prog == NULL || session.reparsed > text_len()) {
+	// (the ASTs replaced by now are as large as the program,
+	// so it is time to parse it whole and give them back)
+	parse_whole();
+	return;
+    }
+    long long main_start = entry_start(session.main);
+    long long main_follow = entry_follow(session.main);
+    if (session.dirty_end <= main_start) {
+	if (reparse_declarations()) {
+	    return;
+	}
+    } else if (session.dirty_start > main_follow) {
+	reparse_end();
+	return;
+    } else if (session.dirty_start >= main_start
+	       && session.dirty_end <= main_follow) {
+	// find the innermost statement around the edit
+	stmt_entry *c = entry_at_or_before(session.dirty_start);
+	while (entry_follow(c) < session.dirty_end) {
+	    c = c->parent;
+	}
+	for (; c != NULL; c = c->parent) {
+	    if (c->stmt->type_tag == begin_ast
+		&& session.dirty_start > entry_start(c) + BEGIN_LEN) {
+		if (reparse_statements(c)) {
+		    return;
+		}
+	    } else if (c != session.main && reparse_statement(c)) {
+		// (the program's statement is not parsed again on its own,
+		// as the declarations before it end by seeing its first token)
+		return;
+	    }
+	}
+    }
+    parse_whole();
+}
+
+// Parse the text again (all of it if whole), as reparse_changed,
+// reporting errors (without stopping), and return whether it parses
+static bool try_parse(bool whole)
+{
+    jmp_buf recovery;
+    jmp_buf *outer = set_error_recovery(&recovery);
+    int saved_errno = errno;
+    session.last_len = 0;
+    errno = 0;
+    if (setjmp(recovery) == 0) {
+	if (whole) {
+	    parse_whole();
+	} else {
+	    reparse_changed();
+	}
+	session.parses = true;
+	session.stale = session.stale || session.last_part != part_program;
+    } else {
+	parse_done();
+	session.parses = false;
+    }
+    set_error_recovery(outer);
+    errno = saved_errno;
+    return session.parses;
+}
+
+// ---------- SESSIONS ----------
+
+// Read the file named fname into the text (with a gap at its end)
+static void read_text(const char *fname)
+{
+    FILE *f = fopen(fname, "rb");
+    if (f == NULL) {
+	bail_with_error("Cannot open %s", fname);
+    }
+    size_t len = 0;
+    session.cap = BUFSIZ;
+    session.buf = (char *) malloc(session.cap);
+    for (;;) {
+	if (session.buf == NULL) {
+	    fclose(f);
+	    bail_with_error("No space for the text of %s!", fname);
+	}
+	len += fread(session.buf + len, 1, session.cap - len, f);
+	if (len < session.cap) {
+	    break;
+	}
+	session.cap = 2 * session.cap;
+	char *buf = (char *) realloc(session.buf, session.cap);
+	if (buf == NULL) {
+	    free(session.buf);
+	}
+	session.buf = buf;
+    }
+    bool failed = ferror(f);
+    fclose(f);
+    if (failed) {
+	bail_with_error("Cannot read %s", fname);
+    }
+    if (len > UINT_MAX) {
+	bail_with_error("File %s is too large!", fname);
+    }
+    if (tokstream_is_stream(session.buf, len)) {
+	bail_with_error("%s holds a token stream, which cannot be edited",
+			fname);
+    }
+    // leave room to insert about an eighth as much again
+    size_t cap = len + len / 8 + MIN_GAP;
+    if (cap > session.cap) {
+	char *buf = (char *) realloc(session.buf, cap);
+	if (buf == NULL) {
+	    bail_with_error("No space for the text of %s!", fname);
+	}
+	session.buf = buf;
+    }
+    session.cap = cap;
+    session.gap_start = len;
+    session.gap_len = cap - len;
+}
+
+// Start a session on the file named fname, returning whether it parses
+bool reparse_open(const char *fname)
+{
+    reparse_close();
+    // (so the lexer does not forget the text's file when it opens another)
+    lexer_release();
+    session.open = true;
+    session.fname = fname;
+    session.rng = 88172645463325252u;
+    read_text(fname);
+    session.file = file_location_add_file(fname, session.buf, text_len());
+    return try_parse(true);
+}
+
+// Replace the chars of the text from start to end by the len chars at text,
+// and return whether the text then parses
+bool reparse_edit(unsigned int start, unsigned int end, const char *text,
+		  size_t len)
+{
+    size_t old_len = text_len();
+    if (start > end || end > old_len
+	|| old_len - (end - start) + len > UINT_MAX) {
+	errno = 0;
+	bail_with_error("Edit from %u to %u is not within %s (of %zu chars)",
+			start, end, session.fname, old_len);
+    }
+    file_location_replace(session.file, start, end, text, len);
+    text_replace(start, end, text, len);
+    unit_stats.reparse_edits++;
+    long long delta = (long long) len - (end - start);
+    if (session.parses) {
+	session.dirty_start = start;
+	session.dirty_end = end;
+	session.delta = delta;
+    } else {
+	// add the edit (mapped back to the text when it last parsed)
+	// to the part changed since then
+	long long dirty_end = session.dirty_end + session.delta;
+	if (start < session.dirty_start) {
+	    session.dirty_start = start;
+	}
+	if (end > dirty_end && end - session.delta > session.dirty_end) {
+	    session.dirty_end = (unsigned int) (end - session.delta);
+	}
+	session.delta += delta;
+    }
+    return try_parse(false);
+}
+
+// Report that the edits in the file named fname are malformed,
+// which does not return
+static void malformed_edit(const char *fname)
+{
+    errno = 0;
+    bail_with_error("Malformed edit in %s", fname);
+}
+
+// Make the edits read from f (named fname) in turn, printing what each
+// parsed again on log (if not NULL), and return whether the text parses
+bool reparse_edit_file(FILE *f, const char *fname, FILE *log)
+{
+    unsigned long num_edits = 0;
+    unsigned int start, end;
+    size_t len;
+    int got;
+    while ((got = fscanf(f, "%u %u %zu", &start, &end, &len)) == 3) {
+	if (getc(f) != '\n') {
+	    malformed_edit(fname);
+	}
+	if (len + 1 > session.edit_cap) {
+	    session.edit_cap = len + 1;
+	    free(session.edit_text);
+	    session.edit_text = (char *) malloc(session.edit_cap);
+	    if (session.edit_text == NULL) {
+		session.edit_cap = 0;
+		bail_with_error("No space for an edit in %s!", fname);
+	    }
+	}
+	if (fread(session.edit_text, 1, len, f) != len) {
+	    malformed_edit(fname);
+	}
+	bool parses = reparse_edit(start, end, session.edit_text, len);
+	num_edits++;
+	if (log != NULL) {
+	    fprintf(log, "edit %lu: parsed %zu chars of %s again%s\n",
+		    num_edits, session.last_len, part_names[session.last_part],
+		    parses ? "" : ", with errors");
+	    fflush(log);
+	}
+    }
+    if (got != EOF) {
+	malformed_edit(fname);
+    }
+    return session.parses;
+}
+
+// Move the file locations of the expression or condition exp
+// (and all in it) by shift chars
+static void shift_exp(AST *exp, long long shift)
+{
+    if (exp == NULL) {
+	// the parser makes a condition without a relational operator NULL
+	return;
+    }
+    exp->file_loc.offset += shift;
+    switch (exp->type_tag) {
+    case odd_cond_ast:
+	shift_exp(exp->data.odd_cond.exp, shift);
+	break;
+    case bin_cond_ast:
+	shift_exp(exp->data.bin_cond.leftexp, shift);
+	shift_exp(exp->data.bin_cond.rightexp, shift);
+	break;
+    case op_expr_ast:
+	shift_exp(exp->data.op_expr.exp, shift);
+	break;
+    case bin_expr_ast:
+	shift_exp(exp->data.bin_expr.leftexp, shift);
+	shift_exp(exp->data.bin_expr.rightexp, shift);
+	break;
+    default:
+	// identifiers and numbers have nothing in them
+	break;
+    }
+}
+
+// Move the file locations of the statement stmt, and those of its
+// expressions and conditions (but not of the statements in it),
+// by shift chars
+static void shift_stmt(AST *stmt, long long shift)
+{
+    stmt->file_loc.offset += shift;
+    switch (stmt->type_tag) {
+    case assign_ast:
+	shift_exp(stmt->data.assign_stmt.exp, shift);
+	break;
+    case if_ast:
+	shift_exp(stmt->data.if_stmt.cond, shift);
+	break;
+    case while_ast:
+	shift_exp(stmt->data.while_stmt.cond, shift);
+	break;
+    case write_ast:
+	shift_exp(stmt->data.write_stmt.exp, shift);
+	break;
+    default:
+	// the other statements hold only statements (or nothing)
+	break;
+    }
+}
+
+// Bring the file locations of the statements of the treap t up to date
+static void refresh_locations(stmt_entry *t)
+{
+    while (t != NULL) {
+	push_shift(t);
+	refresh_locations(t->left);
+	if (t->start != t->stmt->file_loc.offset) {
+	    shift_stmt(t->stmt, t->start - (long long) t->stmt->file_loc.offset);
+	}
+	t = t->right;
+    }
+}
+
+// Return the AST of the session's program, with up to date file locations
+AST *reparse_program()
+{
+    AST *prog = session.prog;
+    if (session.stale) {
+	refresh_locations(session.root);
+	session.stale = false;
+    }
+    // (as parseProgram locates it)
+    if (!ast_list_is_empty(prog->data.program.vds)) {
+	prog->file_loc = ast_list_first(prog->data.program.vds)->file_loc;
+    } else {
+	prog->file_loc = prog->data.program.stmt->file_loc;
+    }
+    return prog;
+}
+
+// End the session, if one is open
+void reparse_close()
+{
+    if (!session.open) {
+	return;
+    }
+    free_entries(session.root);
+    free(session.buf);
+    free(session.records);
+    free(session.entries);
+    free(session.tops);
+    free(session.spine);
+    free(session.edit_text);
+    file_location_clear_files();
+    memset(&session, 0, sizeof(session));
+}
@@ -0,0 +1,70 @@
+#ifndef _REPARSE_H
+#define _REPARSE_H
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "ast.h"
+
+// Incremental parsing of a file being edited (say, in an editor).
+// A session holds the file's text and the AST of its program,
+// and after each edit (a range of the text replaced by new text)
+// parses again only the smallest part of the program holding the edit:
+//   the statements of the innermost begin statement around it,
+//     from the one the edit starts in up to the first one after it
+//     that starts where it did before (shifted by the edit),
+//   or the innermost other statement around it,
+//   or the declarations (for an edit before the program's statement),
+//   or the end of the program (for an edit after its statement).
+// That part is only used if the token after it is the one that was
+// after it before the edit, so that it parses just as it would
+// in the whole program; otherwise the next larger part is tried,
+// up to the whole program.  So errors are reported just as they
+// would be for the whole edited text, and while it has errors,
+// the session keeps the AST of the text that last parsed.
+// The text is kept with a gap at the last edit, and the statements
+// in an index by offset in which all those after an edit are moved
+// at once, so an edit takes time proportional to the part parsed again
+// (and to how far it is from the last edit), not to the file's size.
+// The file locations in the AST are only brought up to date when
+// the whole AST is asked for (by reparse_program); scope checking
+// and the rest of the compiler still work on the whole program.
+// The session, like the lexer and parser it uses, belongs to the thread.
+
+// Requires: fname is the name of a readable file
+//           (of program text, not a token stream)
+// Start a session on the file named fname, reading and parsing it,
+// and return whether it parses (its errors are reported as usual,
+// but the session goes on).  Any session open already is ended.
+extern bool reparse_open(const char *fname);
+
+// Requires: a session is open
+// Replace the chars of the session's text from offset start up to
+// (but not including) offset end by the len chars at text, parse again
+// what that changes, and return whether the whole text now parses.
+// An edit that is not within the text is an error (which bails).
+extern bool reparse_edit(unsigned int start, unsigned int end,
+			 const char *text, size_t len);
+
+// Requires: a session is open and f is open for reading
+// Make the edits read from f (named fname) until its end, in turn,
+// printing on log (if not NULL) a line saying what each parsed again,
+// and return whether the text parses after the last one.
+// Each edit is a line of three decimal numbers, start end len,
+// followed by the len chars that replace those from start to end
+// (see reparse_edit); a malformed edit is an error (which bails).
+extern bool reparse_edit_file(FILE *f, const char *fname, FILE *log);
+
+// Requires: a session is open and its text parses
+// Return the AST of the session's program, with its file locations
+// brought up to date (which takes time proportional to its size).
+// An edit that parses the whole text again gives back all the ASTs
+// made before it (see ast_arena_release), so this is only good
+// until the next edit.
+extern AST *reparse_program();
+
+// End the session, if one is open, giving back its storage
+// and forgetting the file locations of its text (see file_location.h)
+// (its ASTs are given back by ast_arena_release(), as usual)
+extern void reparse_close();
+
+#endif
@@ -1,36 +1,92 @@
-#include <stdlib.h>
-#include <string.h>
-#include "reserved.h"
-
-static const char *reserved_words[NUM_RESERVED_WORDS]
-        = {"const", "var", "procedure",
-           "call", "begin", "end",
-	   "if", "then", "else", "while", "do",
-           "read", "write", "skip", "odd"};
-
-static token_type reserved_types[NUM_RESERVED_WORDS]
-         = {constsym, varsym, procsym,
-           callsym, beginsym, endsym,
-	   ifsym, thensym, elsesym, whilesym, dosym,
-	   readsym, writesym, skipsym, oddsym};
-
-// initialize the data structures of the
-// reserved module
-void reserved_initialize()
-{
-    // nothing to do!
-}
-
-// Requires: text != NULL
-// If text is a reserved word,
-// then return its token_type,
-// else return the token_type identsym
-token_type reserved_type(const char *text)
-{
-    for (int i = 0; i < NUM_RESERVED_WORDS; i++) {
-	if (strcmp(text, reserved_words[i]) == 0) {
-	    return reserved_types[i];
-	}
-    }
-    return identsym;
-}
+#include <stdlib.h>
+#include <string.h>
+#include "reserved.h"
+
+// initialize the data structures of the
+// reserved module
+void reserved_initialize()
+{
+    // nothing to do!
+}
+
+// Requires: text has at least len chars
+// Return typ if text is the reserved word word (whose length is len),
+// else return identsym
+static inline token_type reserved_match(const char *text, const char *word,
+					size_t len, token_type typ)
+{
+    return memcmp(text, word, len) == 0 ? typ : identsym;
+}
+
+// Requires: text != NULL
+// If text is a reserved word,
+// then return its token_type,
+// else return the token_type identsym
+token_type reserved_type(const char *text)
+{
+    return reserved_type_len(text, strlen(text));
+}
+
+// Requires: text has at least len chars
+// If the first len chars of text are a reserved word,
+// then return its token_type,
+// else return the token_type identsym.
+// The length and the first char pick the only reserved word
+// that could match (except for while and write),
+// so at most one comparison is needed.
+token_type reserved_type_len(const char *text, size_t len)
+{
+    switch (len) {
+    case 2:
+	switch (text[0]) {
+	case 'd':
+	    return reserved_match(text, "do", 2, dosym);
+	case 'i':
+	    return reserved_match(text, "if", 2, ifsym);
+	}
+	break;
+    case 3:
+	switch (text[0]) {
+	case 'e':
+	    return reserved_match(text, "end", 3, endsym);
+	case 'o':
+	    return reserved_match(text, "odd", 3, oddsym);
+	case 'v':
+	    return reserved_match(text, "var", 3, varsym);
+	}
+	break;
+    case 4:
+	switch (text[0]) {
+	case 'c':
+	    return reserved_match(text, "call", 4, callsym);
+	case 'e':
+	    return reserved_match(text, "else", 4, elsesym);
+	case 'r':
+	    return reserved_match(text, "read", 4, readsym);
+	case 's':
+	    return reserved_match(text, "skip", 4, skipsym);
+	case 't':
+	    return reserved_match(text, "then", 4, thensym);
+	}
+	break;
+    case 5:
+	switch (text[0]) {
+	case 'b':
+	    return reserved_match(text, "begin", 5, beginsym);
+	case 'c':
+	    return reserved_match(text, "const", 5, constsym);
+	case 'w':
+	    if (text[1] == 'h') {
+		return reserved_match(text, "while", 5, whilesym);
+	    }
+	    return reserved_match(text, "write", 5, writesym);
+	}
+	break;
+    case 9:
+	if (text[0] == 'p') {
+	    return reserved_match(text, "procedure", 9, procsym);
+	}
+	break;
+    }
+    return identsym;
+}
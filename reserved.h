@@ -1,17 +1,24 @@
-#ifndef _RESERVED_H
-#define _RESERVED_H
-#include "token.h"
-
-#define NUM_RESERVED_WORDS 15
-
-// initialize the data structures of the
-// reserved module
-extern void reserved_initialize();
-
-// Requires: text != NULL
-// If text is a reserved word,
-// then return its token_type,
-// else return the token_type nosym
-extern token_type reserved_type(const char *text);
-
-#endif
+#ifndef _RESERVED_H
+#define _RESERVED_H
+#include <stddef.h>
+#include "token.h"
+
+#define NUM_RESERVED_WORDS 15
+
+// initialize the data structures of the
+// reserved module
+extern void reserved_initialize();
+
+// Requires: text != NULL
+// If text is a reserved word,
+// then return its token_type,
+// else return the token_type nosym
+extern token_type reserved_type(const char *text);
+
+// Requires: text has at least len chars
+// If the first len chars of text are a reserved word,
+// then return its token_type,
+// else return the token_type identsym
+extern token_type reserved_type_len(const char *text, size_t len);
+
+#endif
@@ -0,0 +1,139 @@
+// Microbenchmark of reserved word recognition: collect the words
+// (identifiers and reserved words) of the given PL/0 files, then time
+// classifying all of them with reserved_type_len and with the linear
+// search over the reserved words that it replaced
+// (see the reserved-bench target in the Makefile).
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "reserved.h"
+
+static const char *reserved_words[NUM_RESERVED_WORDS]
+        = {"const", "var", "procedure",
+           "call", "begin", "end",
+	   "if", "then", "else", "while", "do",
+           "read", "write", "skip", "odd"};
+
+static token_type reserved_types[NUM_RESERVED_WORDS]
+         = {constsym, varsym, procsym,
+           callsym, beginsym, endsym,
+	   ifsym, thensym, elsesym, whilesym, dosym,
+	   readsym, writesym, skipsym, oddsym};
+
+// The old way: compare text with each reserved word in turn
+static token_type linear_reserved_type(const char *text)
+{
+    for (int i = 0; i < NUM_RESERVED_WORDS; i++) {
+	if (strcmp(text, reserved_words[i]) == 0) {
+	    return reserved_types[i];
+	}
+    }
+    return identsym;
+}
+
+// The words collected, as null-terminated strings, with their lengths
+static char **words;
+static size_t *lens;
+static size_t num_words, words_capacity;
+
+// Add the first len chars of s to the words
+static void add_word(const char *s, size_t len)
+{
+    if (num_words == words_capacity) {
+	words_capacity = words_capacity == 0 ? 1024 : 2 * words_capacity;
+	words = realloc(words, words_capacity * sizeof(char *));
+	lens = realloc(lens, words_capacity * sizeof(size_t));
+	if (words == NULL || lens == NULL) {
+	    fprintf(stderr, "No space for words!\n");
+	    exit(EXIT_FAILURE);
+	}
+    }
+    words[num_words] = strndup(s, len);
+    lens[num_words++] = len;
+}
+
+// Add the words of the file named fname (skipping # comments)
+static void add_file_words(const char *fname)
+{
+    FILE *f = fopen(fname, "r");
+    if (f == NULL) {
+	perror(fname);
+	exit(EXIT_FAILURE);
+    }
+    char word[256];
+    size_t n = 0;
+    int c;
+    while ((c = getc(f)) != EOF) {
+	if (c == '#') {
+	    while (c != EOF && c != '\n') {
+		c = getc(f);
+	    }
+	}
+	if (isalnum(c) && n < sizeof(word) && (n > 0 || isalpha(c))) {
+	    word[n++] = (char) c;
+	} else if (n > 0) {
+	    add_word(word, n);
+	    n = 0;
+	}
+    }
+    if (n > 0) {
+	add_word(word, n);
+    }
+    fclose(f);
+}
+
+// Return the seconds since start
+static double seconds_since(struct timespec *start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+	fprintf(stderr, "Usage: %s repetitions code-filename...\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    int reps = atoi(argv[1]);
+    for (int i = 2; i < argc; i++) {
+	add_file_words(argv[i]);
+    }
+    size_t num_reserved = 0;
+    for (size_t w = 0; w < num_words; w++) {
+	token_type typ = reserved_type_len(words[w], lens[w]);
+	if (typ != linear_reserved_type(words[w])) {
+	    fprintf(stderr, "Disagreement on \"%s\"\n", words[w]);
+	    exit(EXIT_FAILURE);
+	}
+	num_reserved += typ != identsym;
+    }
+    printf("%zu words (%zu reserved), %d repetitions\n",
+	   num_words, num_reserved, reps);
+
+    // sum the results, so the calls cannot be optimized away
+    unsigned long sum = 0;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < reps; r++) {
+	for (size_t w = 0; w < num_words; w++) {
+	    sum += linear_reserved_type(words[w]);
+	}
+    }
+    double linear_secs = seconds_since(&start);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < reps; r++) {
+	for (size_t w = 0; w < num_words; w++) {
+	    sum -= reserved_type_len(words[w], lens[w]);
+	}
+    }
+    double switch_secs = seconds_since(&start);
+    double n = (double) num_words * reps;
+    printf("linear search: %.3f s (%.1f ns/word)\n", linear_secs, 1e9 * linear_secs / n);
+    printf("switch:        %.3f s (%.1f ns/word)\n", switch_secs, 1e9 * switch_secs / n);
+    return sum == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -18,16 +18,21 @@ void scope_check_program(AST *prog)
 }
 
 // Puts given name, which is to be delcared with id_kind vars, and has its declaration at the floc
-// into the current scopes symbl table at the offset scope_Size()
-static void add_ident_to_scope(const char *name, id_kind vars, file_location f_locate)
+// into the current scopes symbl table at the offset scope_Size(), returning that offset
+static unsigned int add_ident_to_scope(const char *name, id_kind vars, file_location f_locate)
 {
+    unsigned int offset = scope_size();
     id_attrs *attrs = scope_lookup(name);
     
     if (attrs != NULL)
         general_error(f_locate,"%s \"%s\" is already declared as a %s",kind2str(vars),name,kind2str(attrs->kind));
 	    
     else 
-        scope_insert(name, create_id_attrs(f_locate, vars, scope_size()));        
+    {
+        id_attrs new_attrs = { f_locate, vars, offset };
+        scope_insert(name, &new_attrs);
+    }
+    return offset;
 }
 
 // builds sym table and checks the declarations in vars
@@ -44,7 +49,7 @@ void scope_check_varDecls(AST_list vars)
 // been declared already. 
 void scope_check_varDecl(AST *var)
 {
-    add_ident_to_scope(var->data.var_decl.name,1,var->file_loc);
+    var->data.var_decl.offset = add_ident_to_scope(var->data.var_decl.name,1,var->file_loc);
 }
 
 // Puts given name, which is to be delcared with id_kind consts, and has its declaration at the floc
@@ -57,7 +62,10 @@ static void add_const_to_scope(const char *name, id_kind consts, file_location f
         general_error(f_locate,"%s \"%s\" is already declared as a %s",kind2str(consts),name,kind2str(attrs->kind)); 
 	    
     else 
-        scope_insert(name, create_id_attrs(f_locate, consts, scope_size()));        
+    {
+        id_attrs new_attrs = { f_locate, consts, scope_size() };
+        scope_insert(name, &new_attrs);
+    }
 }
 
 // builds sym table and checks the declarations in consts
@@ -74,7 +82,7 @@ void scope_check_constDecls(AST_list consts)
 // been declared already. 
 void scope_check_constDecl(AST *consts)
 {
-    add_ident_to_scope(consts->data.const_decl.name,0,consts->file_loc);
+    consts->data.const_decl.offset = add_ident_to_scope(consts->data.const_decl.name,0,consts->file_loc);
 }
 
 // check the statement to make sure that all idents referenced in it have been delcared, otherwise, 
@@ -113,15 +121,15 @@ void scope_check_stmt(AST *stmt)
 // error is returned 
 void scope_check_whileStmt(AST *stmt)
 {
+    scope_check_cond(stmt->data.while_stmt.cond);
     scope_check_stmt(stmt->data.while_stmt.stmt);
-    scope_check_expr(stmt->data.while_stmt.cond);
 }
 
 // check the statement to make sure that all idents referenced in it have been delcared, otherwise, 
 // error is returned 
 void scope_check_assignStmt(AST *stmt)
 {
-    scope_check_ident(stmt->file_loc, stmt->data.assign_stmt.name);
+    stmt->data.assign_stmt.offset = scope_check_ident(stmt->file_loc, stmt->data.assign_stmt.name);
     scope_check_expr(stmt->data.assign_stmt.exp);
 }
 
@@ -150,7 +158,7 @@ void scope_check_ifStmt(AST *stmt)
 // error is returned 
 void scope_check_readStmt(AST *stmt)
 {
-    scope_check_ident(stmt->file_loc, stmt->data.read_stmt.name);
+    stmt->data.read_stmt.offset = scope_check_ident(stmt->file_loc, stmt->data.read_stmt.name);
 }
 
 // check the statement to make sure that all idents referenced in it have been delcared, otherwise, 
@@ -167,7 +175,7 @@ void scope_check_expr(AST *exp)
     switch (exp->type_tag) 
     {
         case ident_ast:
-            scope_check_ident(exp->file_loc, exp->data.ident.name);
+            exp->data.ident.offset = scope_check_ident(exp->file_loc, exp->data.ident.name);
             break;
         case bin_expr_ast:
             scope_check_bin_expr(exp);
@@ -192,10 +200,13 @@ void scope_check_op_expr(AST *exp)
 }
 
 // check that the given name has been declared, if not, then produce an error using the floc given.
-void scope_check_ident(file_location floc, const char *name)
+// returns the offset of the name's declaration
+unsigned int scope_check_ident(file_location floc, const char *name)
 {
-    if (!scope_defined(name)) 
+    id_attrs *attrs = scope_lookup(name);
+    if (attrs == NULL) 
 	    general_error(floc, "identifer \"%s\" is not declared!", name);
+    return attrs->offset;
 }
 
 // check the expresion to make sure that all idents referenced in it have been declared, otherwise,
@@ -220,7 +231,8 @@ void scope_check_cond(AST *cond)
             break;
         default:
              bail_with_error("Unexpected type_tag (%d) in scope_check_cond (for line %d, column %d)!",
-                cond->type_tag, cond->file_loc.line, cond->file_loc.column);
+                cond->type_tag, file_location_line(cond->file_loc),
+                file_location_column(cond->file_loc));
     }
 }
 
@@ -19,10 +19,6 @@
 //  declarations or uses of identifiers that were never delcared.
 extern void scope_check_program(AST *prog);
 
-// Puts given name, which is to be delcared with id_kind vars, and has its declaration at the floc
-// into the current scopes symbl table at the offset scope_Size()
-static void add_ident_to_scope(const char *name, id_kind vars, file_location f_locate);
-
 // builds sym table and checks the declarations in vars
 extern void scope_check_varDecls(AST *vds);
 
@@ -30,10 +26,6 @@ extern void scope_check_varDecls(AST *vds);
 // been declared already. 
 void scope_check_varDecl(AST *var);
 
-// Puts given name, which is to be delcared with id_kind consts, and has its declaration at the floc
-// into the current scopes symbl table at the offset scope_Size()
-static void add_const_to_scope(const char *name, id_kind consts, file_location f_locate);
-
 // builds sym table and checks the declarations in consts
 void scope_check_constDecls(AST_list consts);
 
@@ -79,7 +71,8 @@ extern void scope_check_expr(AST *exp);
 
 // check that the given name has been declared,
 // if not, then produce an error using the file_location (floc) given.
-extern void scope_check_ident(file_location floc, const char *name);
+// returns the offset of the name's declaration (to record in the AST)
+extern unsigned int scope_check_ident(file_location floc, const char *name);
 
 // check the expresion to make sure that all idents referenced in it have been declared, otherwise,
 // error is returned
@@ -5,44 +5,87 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
 #include "scope_symtab.h"
+#include "intern.h"
+#include "stats.h"
 
+// An entry in a scope, which holds the attributes by value
 typedef struct {
     const char *id;
-    id_attrs *attrs;
+    id_attrs attrs;
 } symtab_assoc_t;
 
+// Initial number of entries a scope has room for (a power of 2)
+#define SCOPE_INITIAL_CAPACITY 16
+
+// A scope keeps its entries in a growable array, in declaration order,
+// and indexes them with an open-addressing hash table (with linear
+// probing) keyed by the (interned) names.  The index has twice as many
+// slots as there is room for entries, so it is never more than half full.
+// Each slot holds 1 + the index of its entry, so 0 marks an empty slot.
 typedef struct scope_symtab_s {
     unsigned int size;
-    symtab_assoc_t *entries[MAX_SCOPE_SIZE];
+    unsigned int capacity;
+    symtab_assoc_t *entries;
+    unsigned int *slots;
 } scope_symtab_t;
 
-// The current scope
-static scope_symtab_t *symtab = NULL;
+// The (calling thread's) current scope
+static _Thread_local scope_symtab_t *symtab = NULL;
+
+// Allocate the entries and (empty) index of scope for capacity entries,
+// bailing with an error message if there is no space
+static void scope_allocate_storage(scope_symtab_t *scope, unsigned int capacity)
+{
+    scope->capacity = capacity;
+    scope->entries = malloc(capacity * sizeof(symtab_assoc_t));
+    scope->slots = calloc(2 * capacity, sizeof(unsigned int));
+    stats_count_alloc(stats_scope_entries, capacity * sizeof(symtab_assoc_t));
+    stats_count_alloc(stats_scope_entries, 2 * capacity * sizeof(unsigned int));
+    if (scope->entries == NULL || scope->slots == NULL)
+	    bail_with_error("No space for scope entries!");
+}
 
 // Allocates the memory for a new scope symbol table
 // returns an error message if there is no space and exits the code
 static scope_symtab_t * scope_create()
 {
-    scope_symtab_t *new_scope =  malloc(sizeof(scope_symtab_t));
+    scope_symtab_t *new_scope = malloc(sizeof(scope_symtab_t));
+    stats_count_alloc(stats_scope_entries, sizeof(scope_symtab_t));
     if (new_scope == NULL) 
 	    bail_with_error("No space for new scope_symtab_t!");
     
     new_scope->size = 0;
-
-    for (int j = 0; j < MAX_SCOPE_SIZE; j++) 
-	    new_scope->entries[j] = NULL;
-    
+    scope_allocate_storage(new_scope, SCOPE_INITIAL_CAPACITY);
     return new_scope;
 }
 
+// Free the storage of scope
+static void scope_free(scope_symtab_t *scope)
+{
+    free(scope->entries);
+    free(scope->slots);
+    free(scope);
+}
+
 // initialize the symbol table for the current scope
 void scope_initialize()
 {
+    // a previous unit's scope is no longer needed
+    scope_finalize();
     // assigns the scope to the global symtab
     symtab = scope_create();
 }
 
+// free the symbol table of the current scope (if any)
+void scope_finalize()
+{
+    if (symtab != NULL)
+        scope_free(symtab);
+    symtab = NULL;
+}
+
 // Return the current scope's next offset to use for allocation,
 // which is the size of the current scope.
 unsigned int scope_size()
@@ -50,30 +93,54 @@ unsigned int scope_size()
     return symtab->size;
 }
 
-// Is the scope at max size
-bool scope_full()
+// Return the slot in the index where the interned name is
+// or, if it is not in the index, the empty slot where it belongs,
+// counting it as a lookup (with its probes) in the statistics if counted
+// (which rebuilding the index and inserting a name are not).
+// Since names are interned, the hash is computed from the pointer.
+static unsigned int scope_slot(const char *name, bool counted)
 {
-    return scope_size() >= MAX_SCOPE_SIZE;
+    unsigned int mask = 2 * symtab->capacity - 1;
+    uintptr_t p = (uintptr_t) name;
+    unsigned int i = (unsigned int) ((p ^ (p >> 16)) * 2654435761u) & mask;
+    unsigned long probes = 1;
+    while (symtab->slots[i] != 0
+           && !intern_equal(symtab->entries[symtab->slots[i] - 1].id, name))
+    {
+        i = (i + 1) & mask;
+        probes++;
+    }
+    if (counted)
+    {
+        unit_stats.symtab_lookups++;
+        unit_stats.symtab_probes += probes;
+    }
+    return i;
 }
 
-// Add an association from the given name to the given id
-static void scope_add(symtab_assoc_t *assoc)
+// Double the room for entries in the current scope, rebuilding the index
+static void scope_grow()
 {
-    symtab->entries[symtab->size] = assoc;
-    symtab->size++;
+    symtab_assoc_t *old_entries = symtab->entries;
+    free(symtab->slots);
+    scope_allocate_storage(symtab, 2 * symtab->capacity);
+    memcpy(symtab->entries, old_entries, symtab->size * sizeof(symtab_assoc_t));
+    free(old_entries);
+    for (unsigned int i = 0; i < symtab->size; i++)
+        symtab->slots[scope_slot(symtab->entries[i].id, false)] = i + 1;
 }
 
 // Modify the current scope symbol table to hold a new association
-// if there is not enough room return and error and exit the code.
+// from name to a copy of *attrs, growing the scope if needed.
 void scope_insert(const char *name, id_attrs *attrs)
 {   
-    symtab_assoc_t *new_assoc = malloc(sizeof(symtab_assoc_t));
-    if (new_assoc == NULL) 
-	    bail_with_error("No space for association!");
-    
+    if (symtab->size == symtab->capacity)
+        scope_grow();
+
+    symtab_assoc_t *new_assoc = &symtab->entries[symtab->size];
     new_assoc->id = name;
-    new_assoc->attrs = attrs;
-    scope_add(new_assoc);
+    new_assoc->attrs = *attrs;
+    symtab->slots[scope_slot(name, false)] = ++symtab->size;
 }
 
 // Is the given name associated with some attributes in the current scope?
@@ -86,13 +153,18 @@ bool scope_defined(const char *name)
 
 // Return the attribute attached to some name in the current scope
 // or NULL if none can be found
+// (names are interned, so they are hashed and compared by pointer;
+// with SCOPE_LINEAR defined, for the symtab-bench target in the Makefile,
+// every entry is compared with strcmp instead, as scopes used to be)
 id_attrs *scope_lookup(const char *name)
 {
-    int i;
-    
-    for (i = 0; i < symtab->size; i++) 
-        if (strcmp(symtab->entries[i]->id, name) == 0) 
-            return symtab->entries[i]->attrs;
-
+#ifdef SCOPE_LINEAR
+    for (unsigned int i = 0; i < symtab->size; i++)
+        if (strcmp(symtab->entries[i].id, name) == 0)
+            return &symtab->entries[i].attrs;
     return NULL;
+#else
+    unsigned int slot = symtab->slots[scope_slot(name, true)];
+    return (slot == 0) ? NULL : &symtab->entries[slot - 1].attrs;
+#endif
 }
@@ -10,29 +10,32 @@
 #include "scope_check.h"
 #include "type_attrs.h"
 
-// Maximum number of declarations that can be stored in a scope
-#define MAX_SCOPE_SIZE 4096
-
 // initialize the symbol table for the current scope
 extern void scope_initialize();
 
+// free the symbol table of the current scope (if any)
+extern void scope_finalize();
+
 // Return the current scope's next offset to use for allocation,
 // which is the size of the current scope (number of declared ids).
 extern unsigned int scope_size();
 
-// Is the current scope full?
-extern bool scope_full();
-
+// Requires: name was returned by intern_string (see intern.h)
 // Is the given name associated with some attributes in the current scope?
 extern bool scope_defined(const char *name);
 
+// Requires: name was returned by intern_string (see intern.h)
 // Requires: !scope_defined(name) && attrs != NULL;
 // Modify the current scope symbol table to
-// add an association from the given name to the given id_attrs attrs.
+// add an association from the given name to a copy of *attrs.
+// Scopes grow as needed, so there is no limit on their size.
 extern void scope_insert(const char *name, id_attrs *attrs);
 
+// Requires: name was returned by intern_string (see intern.h)
 // Return (a pointer to) the attributes of the given name in the current scope
 // or NULL if there is no association for name.
+// The result points into the scope's storage,
+// so it is only valid until the next call to scope_insert.
 extern id_attrs *scope_lookup(const char *name);
 
 #endif
@@ -0,0 +1,256 @@
+// Statistics about the compilation of a unit (see stats.h)
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+_Thread_local stats_counters unit_stats;
+
+// When each phase that is being timed started
+static _Thread_local struct timespec wall_start[STATS_NUM_PHASES];
+static _Thread_local struct timespec cpu_start[STATS_NUM_PHASES];
+
+static const char *phase_names[STATS_NUM_PHASES] = {
+    "lex", "cache", "parse", "scope", "optimize", "unparse", "codegen", "run"
+};
+
+static const char *subsystem_names[STATS_NUM_SUBSYSTEMS] = {
+    "lexer_text", "ast", "scope_entries"
+};
+
+static const char *ast_type_names[number_ast + 1] = {
+    "program_ast", "const_decl_ast", "var_decl_ast",
+    "assign_ast", "begin_ast",
+    "if_ast", "while_ast", "read_ast", "write_ast", "skip_ast",
+    "odd_cond_ast", "bin_cond_ast", "op_expr_ast", "bin_expr_ast",
+    "ident_ast", "number_ast"
+};
+
+// Zero all the counters of the calling thread
+void stats_reset()
+{
+    memset(&unit_stats, 0, sizeof(unit_stats));
+}
+
+// Return the number of seconds from start to end
+static double secs_between(struct timespec start, struct timespec end)
+{
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+// Start timing the phase ph
+void stats_phase_begin(stats_phase ph)
+{
+    clock_gettime(CLOCK_MONOTONIC, &wall_start[ph]);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start[ph]);
+}
+
+// Stop timing the phase ph, adding the time since stats_phase_begin(ph)
+void stats_phase_end(stats_phase ph)
+{
+    struct timespec wall_end, cpu_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+    unit_stats.wall_secs[ph] += secs_between(wall_start[ph], wall_end);
+    unit_stats.cpu_secs[ph] += secs_between(cpu_start[ph], cpu_end);
+    unit_stats.timed[ph] = 1;
+}
+
+// Count the nodes of the list l and all their descendants
+static void count_ast(AST *ast);
+static void count_list(AST_list l)
+{
+    while (!ast_list_is_empty(l)) {
+	count_ast(ast_list_first(l));
+	l = ast_list_rest(l);
+    }
+}
+
+// Count the node ast and all its descendants
+static void count_ast(AST *ast)
+{
+    unit_stats.nodes[ast->type_tag]++;
+    switch (ast->type_tag) {
+    case program_ast:
+	count_list(ast->data.program.cds);
+	count_list(ast->data.program.vds);
+	count_ast(ast->data.program.stmt);
+	break;
+    case assign_ast:
+	count_ast(ast->data.assign_stmt.exp);
+	break;
+    case begin_ast:
+	count_list(ast->data.begin_stmt.stmts);
+	break;
+    case if_ast:
+	count_ast(ast->data.if_stmt.cond);
+	count_ast(ast->data.if_stmt.thenstmt);
+	count_ast(ast->data.if_stmt.elsestmt);
+	break;
+    case while_ast:
+	count_ast(ast->data.while_stmt.cond);
+	count_ast(ast->data.while_stmt.stmt);
+	break;
+    case write_ast:
+	count_ast(ast->data.write_stmt.exp);
+	break;
+    case odd_cond_ast:
+	count_ast(ast->data.odd_cond.exp);
+	break;
+    case bin_cond_ast:
+	count_ast(ast->data.bin_cond.leftexp);
+	count_ast(ast->data.bin_cond.rightexp);
+	break;
+    case op_expr_ast:
+	count_ast(ast->data.op_expr.exp);
+	break;
+    case bin_expr_ast:
+	count_ast(ast->data.bin_expr.leftexp);
+	count_ast(ast->data.bin_expr.rightexp);
+	break;
+    default:
+	// the other kinds of nodes have no children
+	break;
+    }
+}
+
+// Count the nodes of prog by type
+void stats_count_ast(AST *prog)
+{
+    memset(unit_stats.nodes, 0, sizeof(unit_stats.nodes));
+    count_ast(prog);
+}
+
+// Return the sum of the n counts
+static unsigned long total(const unsigned long *counts, unsigned int n)
+{
+    unsigned long sum = 0;
+    for (unsigned int i = 0; i < n; i++) {
+	sum += counts[i];
+    }
+    return sum;
+}
+
+// Print s on out as a JSON string
+static void print_json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+	unsigned char c = (unsigned char) *s;
+	if (c == '"' || c == '\\') {
+	    fprintf(out, "\\%c", c);
+	} else if (c < ' ') {
+	    fprintf(out, "\\u%04x", c);
+	} else {
+	    fputc(c, out);
+	}
+    }
+    fputc('"', out);
+}
+
+// Print the counters as text
+static void print_text(FILE *out, const char *fname)
+{
+    fprintf(out, "stats for %s:\n", fname);
+    fprintf(out, "  %-12s %10s %10s\n", "phase", "wall ms", "cpu ms");
+    for (unsigned int ph = 0; ph < STATS_NUM_PHASES; ph++) {
+	if (unit_stats.timed[ph]) {
+	    fprintf(out, "  %-12s %10.3f %10.3f\n", phase_names[ph],
+		    1000 * unit_stats.wall_secs[ph],
+		    1000 * unit_stats.cpu_secs[ph]);
+	}
+    }
+    fprintf(out, "  tokens: %lu\n", total(unit_stats.tokens, eofsym + 1));
+    for (unsigned int t = 0; t <= eofsym; t++) {
+	if (unit_stats.tokens[t] != 0) {
+	    fprintf(out, "    %-12s %10lu\n", ttyp2str((token_type) t),
+		    unit_stats.tokens[t]);
+	}
+    }
+    fprintf(out, "  AST nodes: %lu\n", total(unit_stats.nodes, number_ast + 1));
+    for (unsigned int a = 0; a <= number_ast; a++) {
+	if (unit_stats.nodes[a] != 0) {
+	    fprintf(out, "    %-14s %8lu\n", ast_type_names[a],
+		    unit_stats.nodes[a]);
+	}
+    }
+    fprintf(out, "  symbol table: %lu lookups, %lu probes\n",
+	    unit_stats.symtab_lookups, unit_stats.symtab_probes);
+    if (unit_stats.cache_hits + unit_stats.cache_misses != 0) {
+	fprintf(out, "  AST cache: %lu hits, %lu misses\n",
+		unit_stats.cache_hits, unit_stats.cache_misses);
+    }
+    if (unit_stats.reparse_edits != 0) {
+	fprintf(out, "  edits: %lu edits, %lu chars parsed again,"
+		" %lu whole parses\n",
+		unit_stats.reparse_edits, unit_stats.reparse_chars,
+		unit_stats.reparse_wholes);
+    }
+    fprintf(out, "  %-14s %8s %10s\n", "allocations", "count", "bytes");
+    for (unsigned int s = 0; s < STATS_NUM_SUBSYSTEMS; s++) {
+	fprintf(out, "    %-14s %6lu %10lu\n", subsystem_names[s],
+		unit_stats.allocs[s], unit_stats.alloc_bytes[s]);
+    }
+}
+
+// Print the counters as a JSON object on one line
+static void print_json(FILE *out, const char *fname)
+{
+    fprintf(out, "{\"file\":");
+    print_json_string(out, fname);
+    fprintf(out, ",\"phases\":{");
+    const char *sep = "";
+    for (unsigned int ph = 0; ph < STATS_NUM_PHASES; ph++) {
+	if (unit_stats.timed[ph]) {
+	    fprintf(out, "%s\"%s\":{\"wall_ms\":%.3f,\"cpu_ms\":%.3f}", sep,
+		    phase_names[ph], 1000 * unit_stats.wall_secs[ph],
+		    1000 * unit_stats.cpu_secs[ph]);
+	    sep = ",";
+	}
+    }
+    fprintf(out, "},\"tokens\":{\"total\":%lu,\"by_type\":{",
+	    total(unit_stats.tokens, eofsym + 1));
+    sep = "";
+    for (unsigned int t = 0; t <= eofsym; t++) {
+	if (unit_stats.tokens[t] != 0) {
+	    fprintf(out, "%s\"%s\":%lu", sep, ttyp2str((token_type) t),
+		    unit_stats.tokens[t]);
+	    sep = ",";
+	}
+    }
+    fprintf(out, "}},\"ast_nodes\":{\"total\":%lu,\"by_type\":{",
+	    total(unit_stats.nodes, number_ast + 1));
+    sep = "";
+    for (unsigned int a = 0; a <= number_ast; a++) {
+	if (unit_stats.nodes[a] != 0) {
+	    fprintf(out, "%s\"%s\":%lu", sep, ast_type_names[a],
+		    unit_stats.nodes[a]);
+	    sep = ",";
+	}
+    }
+    fprintf(out, "}},\"symtab\":{\"lookups\":%lu,\"probes\":%lu}",
+	    unit_stats.symtab_lookups, unit_stats.symtab_probes);
+    fprintf(out, ",\"ast_cache\":{\"hits\":%lu,\"misses\":%lu}",
+	    unit_stats.cache_hits, unit_stats.cache_misses);
+    fprintf(out, ",\"edits\":{\"count\":%lu,\"chars_parsed\":%lu,"
+	    "\"whole_parses\":%lu}", unit_stats.reparse_edits,
+	    unit_stats.reparse_chars, unit_stats.reparse_wholes);
+    fprintf(out, ",\"allocations\":{");
+    for (unsigned int s = 0; s < STATS_NUM_SUBSYSTEMS; s++) {
+	fprintf(out, "%s\"%s\":{\"count\":%lu,\"bytes\":%lu}",
+		(s == 0 ? "" : ","), subsystem_names[s],
+		unit_stats.allocs[s], unit_stats.alloc_bytes[s]);
+    }
+    fprintf(out, "}}\n");
+}
+
+// Print the counters of the unit in the file named fname on out,
+// as text or (on one line) as a JSON object, as fmt says
+void stats_print(FILE *out, const char *fname, stats_format fmt)
+{
+    if (fmt == stats_json) {
+	print_json(out, fname);
+    } else {
+	print_text(out, fname);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef _STATS_H
+#define _STATS_H
+#include <stdio.h>
+#include "token.h"
+#include "ast.h"
+
+// Statistics about the compilation of a unit: the time spent in each
+// phase, the tokens by type, the AST nodes by type, the symbol table's
+// probes, the allocations of each subsystem, and the AST cache's
+// hits and misses.
+// They are kept per thread (like all the state of a compilation),
+// so units compiled at the same time are counted separately.
+
+// The phases of a compilation that are timed
+// (parsing includes the lexing it does, lexing alone is only for -l,
+// and cache is looking up the unit's AST in the AST cache and storing it)
+typedef enum {
+    stats_lex, stats_cache, stats_parse, stats_scope, stats_optimize,
+    stats_unparse, stats_codegen, stats_run
+} stats_phase;
+#define STATS_NUM_PHASES (stats_run + 1)
+
+// The subsystems whose allocations are counted
+// (identifiers' attributes are kept in the scope's entries)
+typedef enum {
+    stats_lexer_text, stats_ast, stats_scope_entries
+} stats_subsystem;
+#define STATS_NUM_SUBSYSTEMS (stats_scope_entries + 1)
+
+// How (and whether) to print a unit's statistics
+typedef enum { stats_none, stats_text, stats_json } stats_format;
+
+// The counters for the (calling thread's) current unit
+typedef struct {
+    double wall_secs[STATS_NUM_PHASES];
+    double cpu_secs[STATS_NUM_PHASES];
+    unsigned char timed[STATS_NUM_PHASES]; // did the phase run?
+    unsigned long tokens[eofsym + 1];
+    unsigned long nodes[number_ast + 1];
+    unsigned long symtab_lookups;
+    unsigned long symtab_probes;  // slots looked at by the lookups
+    unsigned long allocs[STATS_NUM_SUBSYSTEMS];
+    unsigned long alloc_bytes[STATS_NUM_SUBSYSTEMS];
+    unsigned long cache_hits;    // units whose AST was in the AST cache
+    unsigned long cache_misses;  // units whose AST was looked up there
+                                 // but not found (so it was stored)
+    unsigned long reparse_edits;   // edits made in a session (see reparse.h)
+    unsigned long reparse_chars;   // chars parsed again after them
+    unsigned long reparse_wholes;  // parses of the whole text in a session
+} stats_counters;
+
+extern _Thread_local stats_counters unit_stats;
+
+// Count an allocation of the given number of bytes by subsystem sub
+#define stats_count_alloc(sub, bytes) \
+    (unit_stats.allocs[sub]++, unit_stats.alloc_bytes[sub] += (bytes))
+
+// Zero all the counters of the calling thread
+extern void stats_reset();
+
+// Start timing the phase ph
+extern void stats_phase_begin(stats_phase ph);
+
+// Stop timing the phase ph, adding the time since stats_phase_begin(ph)
+extern void stats_phase_end(stats_phase ph);
+
+// Requires: prog is a (pointer to a) program AST
+// Count the nodes of prog by type
+extern void stats_count_ast(AST *prog);
+
+// Requires: fmt != stats_none
+// Print the counters of the unit in the file named fname on out,
+// as text or (on one line) as a JSON object, as fmt says
+extern void stats_print(FILE *out, const char *fname, stats_format fmt);
+
+#endif
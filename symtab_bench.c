@@ -0,0 +1,47 @@
+// Benchmark of the scope's symbol table: parse a file once, then time
+// scope checking it many times.  Build it normally to time the hash table,
+// and with -DSCOPE_LINEAR to time the strcmp linear scan it replaced
+// (see the symtab-bench target in the Makefile).
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utilities.h"
+#include "parser_api.h"
+#include "scope_check.h"
+#include "scope_symtab.h"
+
+// the compiler's own main is renamed (with -Dmain=compiler_main)
+// when it is linked into this benchmark
+#undef main
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+	fprintf(stderr, "Usage: %s code-filename repetitions\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    int reps = atoi(argv[2]);
+    parser_open(argv[1]);
+    AST *progast = parseProgram();
+    parser_close();
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < reps; i++) {
+	scope_initialize();
+	scope_check_program(progast);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s: %d scope checks of %s (%u declarations) in %.3f s"
+	   " (%.3f ms each)\n",
+#ifdef SCOPE_LINEAR
+	   "strcmp linear scan",
+#else
+	   "hash table",
+#endif
+	   reps, argv[1], scope_size(), secs, 1000 * secs / reps);
+    scope_finalize();
+    ast_arena_release();
+    return EXIT_SUCCESS;
+}
@@ -1,20 +1,40 @@
-#include "token.h"
-
-// Translation from enum values to strings
-static const char *ttstrs[34] =
-    {"periodsym", "constsym", "semisym", "commasym",
-    "varsym", "procsym", "becomessym", "callsym", "beginsym", "endsym",
-    "ifsym", "thensym", "elsesym", "whilesym", "dosym",
-    "readsym", "writesym", "skipsym",
-    "oddsym", "lparensym", "rparensym",
-    "identsym", "numbersym",
-    "eqsym", "neqsym", "lessym", "leqsym", "gtrsym", "geqsym",
-    "plussym", "minussym", "multsym", "divsym",
-    "eofsym"};
-
-// Return the name of the token_type enum
-// corresponding to the given token_type value
-const char *ttyp2str(token_type ttyp)
-{
-    return ttstrs[ttyp];
-}
+#include <stddef.h>
+#include "token.h"
+
+// Translation from enum values to strings
+static const char *ttstrs[34] =
+    {"periodsym", "constsym", "semisym", "commasym",
+    "varsym", "procsym", "becomessym", "callsym", "beginsym", "endsym",
+    "ifsym", "thensym", "elsesym", "whilesym", "dosym",
+    "readsym", "writesym", "skipsym",
+    "oddsym", "lparensym", "rparensym",
+    "identsym", "numbersym",
+    "eqsym", "neqsym", "lessym", "leqsym", "gtrsym", "geqsym",
+    "plussym", "minussym", "multsym", "divsym",
+    "eofsym"};
+
+// Return the name of the token_type enum
+// corresponding to the given token_type value
+const char *ttyp2str(token_type ttyp)
+{
+    return ttstrs[ttyp];
+}
+
+// Translation from enum values to their spellings in source programs
+static const char *tttexts[34] =
+    {".", "const", ";", ",",
+    "var", "procedure", ":=", "call", "begin", "end",
+    "if", "then", "else", "while", "do",
+    "read", "write", "skip",
+    "odd", "(", ")",
+    NULL, NULL,
+    "=", "<>", "<", "<=", ">", ">=",
+    "+", "-", "*", "/",
+    NULL};
+
+// Return the (fixed) spelling of tokens of type ttyp in source programs,
+// or NULL if tokens of that type have no fixed spelling
+const char *ttyp2text(token_type ttyp)
+{
+    return tttexts[ttyp];
+}
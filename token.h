@@ -1,34 +1,43 @@
-/* $Id: token.h,v 1.7 2023/02/01 17:14:05 leavens Exp leavens $ */
-#ifndef _TOKEN_H
-#define _TOKEN_H
-
-#define MAX_IDENT_LENGTH 255
-
-// types of tokens
-typedef enum {
-    periodsym, constsym, semisym, commasym,
-    varsym, procsym, becomessym, callsym, beginsym, endsym, 
-    ifsym, thensym, elsesym, whilesym, dosym, 
-    readsym, writesym, skipsym,
-    oddsym, lparensym, rparensym,
-    identsym, numbersym, 
-    eqsym, neqsym, lessym, leqsym, gtrsym, geqsym, 
-    plussym, minussym, multsym, divsym, 
-    eofsym
-} token_type;
-
-// information about each token
-typedef struct token {
-    token_type typ;
-    const char *filename;
-    unsigned int line;
-    unsigned int column;
-    char *text; // non-NULL, if applicable
-    short int value; // when typ==numbersym, its value
-} token;
-
-// Return the name of the token_type enum
-// corresponding to the given token_type value
-extern const char *ttyp2str(token_type ttyp);
-
-#endif
+/* $Id: token.h,v 1.7 2023/02/01 17:14:05 leavens Exp leavens $ */
+#ifndef _TOKEN_H
+#define _TOKEN_H
+
+#define MAX_IDENT_LENGTH 255
+
+// types of tokens
+typedef enum {
+    periodsym, constsym, semisym, commasym,
+    varsym, procsym, becomessym, callsym, beginsym, endsym, 
+    ifsym, thensym, elsesym, whilesym, dosym, 
+    readsym, writesym, skipsym,
+    oddsym, lparensym, rparensym,
+    identsym, numbersym, 
+    eqsym, neqsym, lessym, leqsym, gtrsym, geqsym, 
+    plussym, minussym, multsym, divsym, 
+    eofsym
+} token_type;
+
+// information about each token
+typedef struct token {
+    token_type typ;
+    // where the token starts: the id of its file (see file_location.h)
+    // and its offset in bytes from the start of that file
+    unsigned int file;
+    unsigned int offset;
+    short int value; // when typ==numbersym, its value
+    // non-NULL, if applicable; this is shared, read-only storage
+    // (owned by the lexer), not a fresh copy for each token
+    const char *text;
+} token;
+
+// Return the name of the token_type enum
+// corresponding to the given token_type value
+extern const char *ttyp2str(token_type ttyp);
+
+// Return the (fixed) spelling of tokens of type ttyp in source programs,
+// e.g., ":=" for becomessym and "begin" for beginsym,
+// or NULL if tokens of that type have no fixed spelling
+// (i.e., for identsym, numbersym, and eofsym)
+extern const char *ttyp2text(token_type ttyp);
+
+#endif
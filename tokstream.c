@@ -0,0 +1,314 @@
+// Binary token streams (see tokstream.h)
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utilities.h"
+#include "lexer.h"
+#include "file_location.h"
+#include "intern.h"
+#include "writer.h"
+#include "tokstream.h"
+
+// Does a token of type ttyp carry a text of its own in a stream?
+static bool has_own_text(token_type ttyp)
+{
+    return ttyp == identsym || ttyp == numbersym;
+}
+
+// Write n to w as an unsigned varint
+static void write_varint(writer *w, uint32_t n)
+{
+    while (n >= 0x80) {
+	writer_putc(w, (char) ((n & 0x7f) | 0x80));
+	n >>= 7;
+    }
+    writer_putc(w, (char) n);
+}
+
+// Write the len chars at s to w, preceded by len
+static void write_chars(writer *w, const char *s, size_t len)
+{
+    write_varint(w, (uint32_t) len);
+    writer_write(w, s, len);
+}
+
+// The texts written so far, as an open-addressing hash table
+// from the (interned, so unique) text pointers to their indexes
+typedef struct {
+    const char **keys;
+    uint32_t *indexes;
+    uint32_t capacity; // a power of 2
+    uint32_t count;
+} text_table;
+
+// Return the slot of text in tt, or the empty slot where it belongs
+static uint32_t text_slot(text_table *tt, const char *text)
+{
+    uintptr_t p = (uintptr_t) text;
+    uint32_t i = (uint32_t) ((p ^ (p >> 16)) * 2654435761u) & (tt->capacity - 1);
+    while (tt->keys[i] != NULL && tt->keys[i] != text) {
+	i = (i + 1) & (tt->capacity - 1);
+    }
+    return i;
+}
+
+// Make tt an empty table with room for cap texts
+static void text_table_init(text_table *tt, uint32_t cap)
+{
+    tt->keys = (const char **) calloc(2 * cap, sizeof(const char *));
+    tt->indexes = (uint32_t *) malloc(2 * cap * sizeof(uint32_t));
+    if (tt->keys == NULL || tt->indexes == NULL) {
+	bail_with_error("No space for the texts of a token stream!");
+    }
+    tt->capacity = 2 * cap;
+    tt->count = 0;
+}
+
+// Add text (which is not in tt) to tt, with the next index
+static void text_table_add(text_table *tt, const char *text)
+{
+    if (2 * (tt->count + 1) > tt->capacity) {
+	text_table bigger;
+	text_table_init(&bigger, tt->capacity);
+	for (uint32_t i = 0; i < tt->capacity; i++) {
+	    if (tt->keys[i] != NULL) {
+		uint32_t j = text_slot(&bigger, tt->keys[i]);
+		bigger.keys[j] = tt->keys[i];
+		bigger.indexes[j] = tt->indexes[i];
+	    }
+	}
+	bigger.count = tt->count;
+	free(tt->keys);
+	free(tt->indexes);
+	*tt = bigger;
+    }
+    uint32_t i = text_slot(tt, text);
+    tt->keys[i] = text;
+    tt->indexes[i] = tt->count++;
+}
+
+// Write all the tokens of the lexer's file as a token stream on out
+// (through a buffered writer), leaving the lexer done
+void tokstream_write(FILE *out)
+{
+    writer *w = (writer *) malloc(sizeof(writer));
+    if (w == NULL) {
+	bail_with_error("No space for a writer!");
+    }
+    writer_init(w, out);
+    writer_write(w, TOKSTREAM_MAGIC, TOKSTREAM_MAGIC_LEN);
+    const char *name = lexer_filename();
+    write_chars(w, name, strlen(name));
+
+    text_table texts;
+    text_table_init(&texts, 256);
+    unsigned int prev_offset = 0, prev_line = 1;
+    token t;
+    do {
+	t = lexer_next();
+	file_location floc = token2file_loc(t);
+	unsigned int line = file_location_line(floc);
+	writer_putc(w, (char) t.typ);
+	write_varint(w, t.offset - prev_offset);
+	write_varint(w, line - prev_line);
+	write_varint(w, file_location_column(floc));
+	prev_offset = t.offset;
+	prev_line = line;
+	if (has_own_text(t.typ)) {
+	    uint32_t slot = text_slot(&texts, t.text);
+	    if (texts.keys[slot] != NULL) {
+		write_varint(w, texts.indexes[slot]);
+	    } else {
+		write_varint(w, texts.count);
+		write_chars(w, t.text, strlen(t.text));
+		text_table_add(&texts, t.text);
+	    }
+	}
+    } while (t.typ != eofsym);
+
+    free(texts.keys);
+    free(texts.indexes);
+    writer_flush(w);
+    free(w);
+}
+
+// Is the len chars at buf the start of a token stream?
+bool tokstream_is_stream(const char *buf, size_t len)
+{
+    return len >= TOKSTREAM_MAGIC_LEN
+	&& memcmp(buf, TOKSTREAM_MAGIC, TOKSTREAM_MAGIC_LEN) == 0;
+}
+
+struct tokstream_reader_s {
+    const char *pos;	// the next byte to read
+    const char *end;
+    const char *fname;	// the stream's file name
+    char *source_name;	// (malloc-ed, null-terminated)
+    unsigned int file;	// the source file's id (see file_location.h)
+    unsigned int offset;	// of the last token read
+    unsigned int line;	// of the last token read
+    unsigned int column;	// of the last token read
+    unsigned int num_tokens;	// read so far
+    const char **texts;	// the (interned) texts seen so far
+    uint32_t num_texts;
+    uint32_t texts_cap;
+};
+
+// Report that r's stream is malformed, which does not return
+static void malformed(tokstream_reader *r)
+{
+    bail_with_error("Malformed token stream in %s!", r->fname);
+}
+
+// Read an unsigned varint from r's stream
+static uint32_t read_varint(tokstream_reader *r)
+{
+    uint32_t n = 0;
+    for (unsigned int shift = 0; shift < 35; shift += 7) {
+	if (r->pos == r->end) {
+	    malformed(r);
+	}
+	unsigned char b = (unsigned char) *r->pos++;
+	n |= (uint32_t) (b & 0x7f) << shift;
+	if ((b & 0x80) == 0) {
+	    return n;
+	}
+    }
+    malformed(r);
+    return 0;
+}
+
+// Read a length and that many chars from r's stream,
+// setting *len to the length and returning where the chars start
+static const char *read_chars(tokstream_reader *r, uint32_t *len)
+{
+    *len = read_varint(r);
+    if ((size_t) (r->end - r->pos) < *len) {
+	malformed(r);
+    }
+    const char *ret = r->pos;
+    r->pos += *len;
+    return ret;
+}
+
+// Return a reader for the token stream at buf (whose file name is fname,
+// for error messages), recording its source file with file_location
+tokstream_reader *tokstream_open(const char *buf, size_t len,
+				 const char *fname)
+{
+    // read the header before allocating, so a malformed one leaks nothing
+    tokstream_reader header;
+    header.pos = buf + TOKSTREAM_MAGIC_LEN;
+    header.end = buf + len;
+    header.fname = fname;
+    uint32_t name_len;
+    const char *name = read_chars(&header, &name_len);
+    tokstream_reader *r = (tokstream_reader *) malloc(sizeof(tokstream_reader));
+    char *source_name = (char *) malloc(name_len + 1);
+    if (r == NULL || source_name == NULL) {
+	free(r);
+	free(source_name);
+	bail_with_error("No space for a token stream reader!");
+    }
+    *r = header;
+    r->texts = NULL;
+    r->num_texts = 0;
+    r->texts_cap = 0;
+    r->offset = 0;
+    r->line = 1;
+    r->column = 1;
+    r->num_tokens = 0;
+    memcpy(source_name, name, name_len);
+    source_name[name_len] = '\0';
+    r->source_name = source_name;
+    r->file = file_location_add_file(r->source_name, NULL, 0);
+    return r;
+}
+
+// Return the name of the source file of the tokens in r's stream
+const char *tokstream_source_name(tokstream_reader *r)
+{
+    return r->source_name;
+}
+
+// Return the text of a token of r's stream with its own text
+static const char *read_text(tokstream_reader *r)
+{
+    uint32_t index = read_varint(r);
+    if (index < r->num_texts) {
+	return r->texts[index];
+    } else if (index > r->num_texts) {
+	malformed(r);
+    }
+    if (r->num_texts == r->texts_cap) {
+	r->texts_cap = (r->texts_cap == 0) ? 256 : 2 * r->texts_cap;
+	r->texts = (const char **) realloc(r->texts,
+					   r->texts_cap * sizeof(const char *));
+	if (r->texts == NULL) {
+	    bail_with_error("No space for the texts of a token stream!");
+	}
+    }
+    uint32_t len;
+    const char *chars = read_chars(r, &len);
+    if (len == 0) {
+	malformed(r);
+    }
+    r->texts[r->num_texts] = intern_string(chars, len);
+    return r->texts[r->num_texts++];
+}
+
+// Return the next token of r's stream,
+// bailing with an error message if the stream is malformed
+token tokstream_next(tokstream_reader *r)
+{
+    token t;
+    if (r->pos == r->end || (unsigned char) *r->pos > eofsym) {
+	malformed(r);
+    }
+    t.typ = (token_type) *r->pos++;
+    r->offset += read_varint(r);
+    uint32_t line_delta = read_varint(r);
+    r->column = read_varint(r);
+    if (r->column == 0 || r->column - 1 > r->offset) {
+	malformed(r);
+    }
+    if (line_delta > 0 || r->num_tokens == 0) {
+	r->line += line_delta;
+	// so the line and column of the tokens on this line
+	// can be found from their offsets
+	file_location_add_line(r->file, r->offset - (r->column - 1), r->line);
+    }
+    r->num_tokens++;
+    t.file = r->file;
+    t.offset = r->offset;
+    t.value = 0;
+    if (has_own_text(t.typ)) {
+	t.text = read_text(r);
+	if (t.typ == numbersym) {
+	    t.value = (short int) atoi(t.text);
+	}
+    } else {
+	t.text = ttyp2text(t.typ);
+    }
+    return t;
+}
+
+// Return the line of the last token r returned
+unsigned int tokstream_line(tokstream_reader *r)
+{
+    return r->line;
+}
+
+// Return the column of the last token r returned
+unsigned int tokstream_column(tokstream_reader *r)
+{
+    return r->column;
+}
+
+// Give back the storage of r
+void tokstream_close(tokstream_reader *r)
+{
+    free(r->source_name);
+    free(r->texts);
+    free(r);
+}
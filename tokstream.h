@@ -0,0 +1,65 @@
+#ifndef _TOKSTREAM_H
+#define _TOKSTREAM_H
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "token.h"
+
+// Binary token streams: a compact encoding of all the tokens of a file,
+// so a file can be lexed once and its tokens read back (by the lexer,
+// for the parser or any other tool) without lexing it again.
+//
+// A stream is TOKSTREAM_MAGIC, then the name of the source file,
+// then each token (ending with the eofsym token), where a token is
+//   - its type (a byte),
+//   - its offset minus the previous token's offset,
+//   - its line minus the previous token's line,
+//   - its column,
+//   - for identsym and numbersym tokens only, the index of its text
+//     in the table of the texts seen so far in the stream;
+//     an index equal to the size of that table adds a new text,
+//     whose length and chars follow.
+// All numbers are unsigned varints (7 bits per byte, low bits first,
+// the high bit set in all but the last byte); names and texts are
+// a varint length followed by that many chars.
+
+// The bytes a token stream starts with
+// (a PL/0 program cannot start with them, as \001 is not a legal char)
+#define TOKSTREAM_MAGIC "PL0T\001"
+#define TOKSTREAM_MAGIC_LEN 5
+
+// Requires: the lexer is not done
+// Write all the tokens of the lexer's file as a token stream on out
+// (through a buffered writer), leaving the lexer done
+extern void tokstream_write(FILE *out);
+
+// Is the len chars at buf the start of a token stream?
+extern bool tokstream_is_stream(const char *buf, size_t len);
+
+// A reader of a token stream
+typedef struct tokstream_reader_s tokstream_reader;
+
+// Requires: tokstream_is_stream(buf, len), and the len chars
+//           at buf stay valid until the reader is closed
+// Return a reader for the token stream at buf (whose file name is fname,
+// for error messages), recording its source file with file_location
+extern tokstream_reader *tokstream_open(const char *buf, size_t len,
+					const char *fname);
+
+// Return the name of the source file of the tokens in r's stream
+extern const char *tokstream_source_name(tokstream_reader *r);
+
+// Requires: r has not returned its eofsym token
+// Return the next token of r's stream,
+// bailing with an error message if the stream is malformed
+extern token tokstream_next(tokstream_reader *r);
+
+// Return the line and column of the last token r returned
+// (or of the start of the file if it has not returned any)
+extern unsigned int tokstream_line(tokstream_reader *r);
+extern unsigned int tokstream_column(tokstream_reader *r);
+
+// Give back the storage of r
+extern void tokstream_close(tokstream_reader *r);
+
+#endif
@@ -1,10 +1,10 @@
-/* $Id: type_attrs.h,v 1.1 2023/02/22 03:33:43 leavens Exp $ */
-#ifndef _TYPE_ATTRS_H
-#define _TYPE_ATTRS_H
-#include "ast.h"
-#include "id_attrs.h"
-
-// Return a string representing the var_type given
-extern const char *vt2str(id_kind k);
-
-#endif
+/* $Id: type_attrs.h,v 1.1 2023/02/22 03:33:43 leavens Exp $ */
+#ifndef _TYPE_ATTRS_H
+#define _TYPE_ATTRS_H
+#include "ast.h"
+#include "id_attrs.h"
+
+// Return a string representing the var_type given
+extern const char *vt2str(id_kind k);
+
+#endif
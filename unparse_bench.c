@@ -0,0 +1,49 @@
+// Benchmark of the unparser: parse a file once, then time unparsing it
+// many times to /dev/null.  Build it normally to time the buffered writer,
+// and with -DWRITER_STDIO to time writing each piece with stdio instead
+// (see the unparse-bench target in the Makefile).
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "utilities.h"
+#include "parser_api.h"
+#include "unparser.h"
+
+// the compiler's own main is renamed (with -Dmain=compiler_main)
+// when it is linked into this benchmark
+#undef main
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3) {
+	fprintf(stderr, "Usage: %s code-filename repetitions\n", argv[0]);
+	exit(EXIT_FAILURE);
+    }
+    int reps = atoi(argv[2]);
+    parser_open(argv[1]);
+    AST *progast = parseProgram();
+    parser_close();
+    FILE *devnull = fopen("/dev/null", "w");
+    if (devnull == NULL) {
+	bail_with_error("Cannot open /dev/null");
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < reps; i++) {
+	unparseProgram(devnull, progast);
+    }
+    fflush(devnull);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s: %d unparses of %s in %.3f s (%.3f ms each)\n",
+#ifdef WRITER_STDIO
+	   "stdio",
+#else
+	   "writer",
+#endif
+	   reps, argv[1], secs, 1000 * secs / reps);
+    fclose(devnull);
+    ast_arena_release();
+    return EXIT_SUCCESS;
+}
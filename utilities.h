@@ -1,50 +1,65 @@
-/* $Id: utilities.h,v 1.5 2023/02/19 03:07:27 leavens Exp $ */
-#ifndef _UTILITIES_H
-#define _UTILITIES_H
-#include <stdbool.h>
-#include <assert.h>
-#include "token.h"
-#include "file_location.h"
-
-// If NDEBUG is defined, do nothing, otherwise (when debugging)
-// flush stderr and stdout, then print the message given on stderr,
-// using printf formatting from the format string fmt.
-// This function returns normally.
-void debug_print(const char *fmt, ...);
-
-// Format a string error message and print it using perror (for an OS error)
-// then exit with a failure code, so a call to this does not return.
-extern void bail_with_error(const char *fmt, ...);
-
-// Print a lexical error message to stderr
-// starting with the filename, a colon, the line number, a comma
-// the column number, a colon, and then the message.
-// Output goes to stderr and then an exit with a failure code,
-// so a call to this function does not return.
-extern void lexical_error(const char *filename, unsigned int line,
-			  unsigned int column, const char *fmt, ...);
-
-// Requires num_expected > 0 and expected has num_expected elements.
-// Print a parsing error message on stderr
-// starting with the filename, a colon, the line number, a comma
-// the column number, a colon, and then the message.
-// Then exit with a failure code, so this function does not return.
-// The message says that one of the token types in expected
-// was expected, but instead the next token (saw) was seen.
-extern void parse_error_unexpected(token_type *expected,
-				   unsigned int num_expected,
-				   token saw);
-
-// Print a parsing error message on stderr from the parser
-// starting with the filename, a colon, the line number, a comma
-// the column number, a colon, and then the message.
-// Then exit with a failure code, so this function does not return.
-extern void parse_error_general(token t, const char *fmt, ...);
-
-// Print a compiler error message on stderr
-// starting with the filename, a colon, the line number, a comma
-// the column number, a colon, and then the message.
-// Then exit with a failure code, so this function does not return.
-extern void general_error(file_location floc, const char *fmt, ...);
-
-#endif
+/* $Id: utilities.h,v 1.5 2023/02/19 03:07:27 leavens Exp $ */
+#ifndef _UTILITIES_H
+#define _UTILITIES_H
+#include <stdbool.h>
+#include <stdio.h>
+#include <assert.h>
+#include <setjmp.h>
+#include "token.h"
+#include "file_location.h"
+
+// If NDEBUG is defined, do nothing, otherwise (when debugging)
+// flush stderr and stdout, then print the message given on stderr,
+// using printf formatting from the format string fmt.
+// This function returns normally.
+void debug_print(const char *fmt, ...);
+
+// If env is not NULL, make the error reporting functions below
+// (after printing their message) longjmp to *env with the value 1,
+// instead of exiting, so that a caller can recover from an error.
+// If env is NULL, errors exit with a failure code again.
+// This only affects errors in the calling thread.
+// Return the env given by the previous call (or NULL if none),
+// so a caller can recover from errors itself and then restore it.
+extern jmp_buf *set_error_recovery(jmp_buf *env);
+
+// Make the error reporting functions below print their messages on f,
+// or on stderr (as they do by default) if f is NULL.
+// This only affects errors in the calling thread.
+extern void set_error_stream(FILE *f);
+
+// Format a string error message and print it using perror (for an OS error)
+// then exit with a failure code, so a call to this does not return.
+extern void bail_with_error(const char *fmt, ...);
+
+// Print a lexical error message to stderr
+// starting with the filename, a colon, the line number, a comma
+// the column number (all of floc), a colon, and then the message.
+// Output goes to stderr and then an exit with a failure code,
+// so a call to this function does not return.
+extern void lexical_error(file_location floc, const char *fmt, ...);
+
+// Requires num_expected > 0 and expected has num_expected elements.
+// Print a parsing error message on stderr
+// starting with the filename, a colon, the line number, a comma
+// the column number, a colon, and then the message.
+// Then exit with a failure code, so this function does not return.
+// The message says that one of the token types in expected
+// was expected, but instead the next token (saw) was seen.
+extern void parse_error_unexpected(token_type *expected,
+				   unsigned int num_expected,
+				   token saw);
+
+// Print a parsing error message on stderr from the parser
+// starting with the filename, a colon, the line number, a comma
+// the column number, a colon, and then the message.
+// Then exit with a failure code, so this function does not return.
+extern void parse_error_general(token t, const char *fmt, ...);
+
+// Print a compiler error message on stderr
+// starting with the filename, a colon, the line number, a comma
+// the column number, a colon, and then the message.
+// Then exit with a failure code, so this function does not return.
+extern void general_error(file_location floc, const char *fmt, ...);
+
+#endif
@@ -0,0 +1,283 @@
+// The PL/0 virtual machine, which runs bytecode files (see code.h)
+#include <stdio.h>
+#include <stdlib.h>
+#include "utilities.h"
+#include "code.h"
+
+// With GCC (and compatible compilers) the machine uses direct threading:
+// each instruction holds the address of the code that executes it,
+// and each instruction's code jumps straight to the next one's.
+// Otherwise (or if VM_NO_THREADING is defined)
+// it uses a switch statement in a loop.
+#if defined(__GNUC__) && !defined(VM_NO_THREADING)
+#define VM_THREADED 1
+#endif
+
+// An instruction decoded for execution
+typedef struct {
+    const void *target; // address of the code for op (when threaded)
+    op_code op;
+    int32_t arg;
+} vm_instr;
+
+/* Print a usage message on stderr 
+   and exit with failure. */
+static void usage(const char *cmdname)
+{
+    fprintf(stderr, "Usage: %s bytecode-filename\n", cmdname);
+    exit(EXIT_FAILURE);
+}
+
+// Return the change in the stack's height made by instructions with op
+static int vm_stack_effect(op_code op)
+{
+    switch (op) {
+    case op_lit: case op_lod: case op_rch:
+	return 1;
+    case op_odd: case op_jmp: case op_hlt:
+	return 0;
+    default:
+	// stores, binary operators, op_jpc and op_wch all pop 1 net value
+	return -1;
+    }
+}
+
+// Return the number of values instructions with op pop
+static int vm_stack_needs(op_code op)
+{
+    switch (op) {
+    case op_lit: case op_lod: case op_rch: case op_jmp: case op_hlt:
+	return 0;
+    case op_sto: case op_odd: case op_jpc: case op_wch:
+	return 1;
+    default:
+	return 2;
+    }
+}
+
+// Check that cs is safe to run: every instruction is valid,
+// every variable and jump target is in range,
+// the stack never underflows and has the same height
+// whenever an instruction is reached, and control never runs off
+// the end of the code.  Bail with an error message if not.
+// Return the largest height the stack can reach.
+static unsigned int vm_verify(code_seq *cs)
+{
+    if (cs->count == 0) {
+	bail_with_error("The program has no instructions!");
+    }
+    // no instruction can address a larger frame
+    if (cs->frame_size > INSTR_ARG_MAX + 1) {
+	bail_with_error("Bad frame size %u!", cs->frame_size);
+    }
+    int32_t *heights = (int32_t *) malloc(cs->count * sizeof(int32_t));
+    uint32_t *work = (uint32_t *) malloc(cs->count * sizeof(uint32_t));
+    if (heights == NULL || work == NULL) {
+	bail_with_error("No space to verify the program!");
+    }
+    for (uint32_t i = 0; i < cs->count; i++) {
+	op_code op = instr_op(cs->instrs[i]);
+	int32_t arg = instr_arg(cs->instrs[i]);
+	if (op >= NUM_OP_CODES) {
+	    bail_with_error("Bad op code %d at instruction %u!", op, i);
+	}
+	if ((op == op_lod || op == op_sto)
+	    && (arg < 0 || (uint32_t) arg >= cs->frame_size)) {
+	    bail_with_error("Bad variable offset %d at instruction %u!", arg, i);
+	}
+	if ((op == op_jmp || op == op_jpc)
+	    && (arg < 0 || (uint32_t) arg >= cs->count)) {
+	    bail_with_error("Bad jump target %d at instruction %u!", arg, i);
+	}
+	heights[i] = -1;
+    }
+    unsigned int max = 0;
+    uint32_t num_work = 0;
+    heights[0] = 0;
+    work[num_work++] = 0;
+    while (num_work > 0) {
+	uint32_t i = work[--num_work];
+	op_code op = instr_op(cs->instrs[i]);
+	if (heights[i] < vm_stack_needs(op)) {
+	    bail_with_error("Stack underflow at instruction %u!", i);
+	}
+	int32_t h = heights[i] + vm_stack_effect(op);
+	if ((unsigned int) h > max) {
+	    max = h;
+	}
+	uint32_t succs[2];
+	int num_succs = 0;
+	if (op != op_jmp && op != op_hlt) {
+	    if (i + 1 == cs->count) {
+		bail_with_error("Execution can run off the end of the code!");
+	    }
+	    succs[num_succs++] = i + 1;
+	}
+	if (op == op_jmp || op == op_jpc) {
+	    succs[num_succs++] = instr_arg(cs->instrs[i]);
+	}
+	for (int k = 0; k < num_succs; k++) {
+	    uint32_t s = succs[k];
+	    if (heights[s] < 0) {
+		heights[s] = h;
+		work[num_work++] = s;
+	    } else if (heights[s] != h) {
+		bail_with_error("Inconsistent stack height at instruction %u!", s);
+	    }
+	}
+    }
+    free(heights);
+    free(work);
+    return max;
+}
+
+// Report an error that happened while running instruction pc
+// (on stderr) and exit with a failure code
+static void vm_runtime_error(uint32_t pc, const char *msg)
+{
+    fflush(stdout);
+    fprintf(stderr, "Runtime error at instruction %u: %s\n", pc, msg);
+    exit(EXIT_FAILURE);
+}
+
+// Requires: cs has been verified, and its stack never gets higher
+// than max_stack.
+// Run the program cs until it halts.
+static void vm_run(code_seq *cs, unsigned int max_stack)
+{
+#ifdef VM_THREADED
+    static const void *targets[NUM_OP_CODES] =
+	{&&do_op_lit, &&do_op_lod, &&do_op_sto,
+	 &&do_op_add, &&do_op_sub, &&do_op_mul, &&do_op_div,
+	 &&do_op_eql, &&do_op_neq, &&do_op_lss, &&do_op_leq,
+	 &&do_op_gtr, &&do_op_geq, &&do_op_odd, &&do_op_jmp, &&do_op_jpc,
+	 &&do_op_rch, &&do_op_wch, &&do_op_hlt};
+#define VM_CASE(op) do_##op:
+#define VM_NEXT() goto *(++pc)->target
+#define VM_JUMP(i) do { pc = code + (i); goto *pc->target; } while (0)
+#else
+#define VM_CASE(op) case op:
+#define VM_NEXT() pc++; continue
+#define VM_JUMP(i) pc = code + (i); continue
+#endif
+    vm_instr *code = (vm_instr *) malloc(cs->count * sizeof(vm_instr));
+    short *frame = (short *) calloc((size_t) cs->frame_size + 1, sizeof(short));
+    short *stack = (short *) malloc((max_stack + 1) * sizeof(short));
+    if (code == NULL || frame == NULL || stack == NULL) {
+	bail_with_error("No space to run the program!");
+    }
+    for (uint32_t i = 0; i < cs->count; i++) {
+	code[i].op = instr_op(cs->instrs[i]);
+	code[i].arg = instr_arg(cs->instrs[i]);
+#ifdef VM_THREADED
+	code[i].target = targets[code[i].op];
+#else
+	code[i].target = NULL;
+#endif
+    }
+    vm_instr *pc = code;
+    short *sp = stack; // the next free slot on the stack
+#ifdef VM_THREADED
+    goto *pc->target;
+#else
+    for (;;) {
+	switch (pc->op) {
+#endif
+	VM_CASE(op_lit)
+	    *sp++ = (short) pc->arg;
+	    VM_NEXT();
+	VM_CASE(op_lod)
+	    *sp++ = frame[pc->arg];
+	    VM_NEXT();
+	VM_CASE(op_sto)
+	    frame[pc->arg] = *--sp;
+	    VM_NEXT();
+	VM_CASE(op_add)
+	    sp--;
+	    sp[-1] = (short) (sp[-1] + sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_sub)
+	    sp--;
+	    sp[-1] = (short) (sp[-1] - sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_mul)
+	    sp--;
+	    sp[-1] = (short) (sp[-1] * sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_div)
+	    sp--;
+	    if (sp[0] == 0) {
+		vm_runtime_error(pc - code, "division by zero");
+	    }
+	    sp[-1] = (short) (sp[-1] / sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_eql)
+	    sp--;
+	    sp[-1] = (sp[-1] == sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_neq)
+	    sp--;
+	    sp[-1] = (sp[-1] != sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_lss)
+	    sp--;
+	    sp[-1] = (sp[-1] < sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_leq)
+	    sp--;
+	    sp[-1] = (sp[-1] <= sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_gtr)
+	    sp--;
+	    sp[-1] = (sp[-1] > sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_geq)
+	    sp--;
+	    sp[-1] = (sp[-1] >= sp[0]);
+	    VM_NEXT();
+	VM_CASE(op_odd)
+	    sp[-1] = (sp[-1] % 2 != 0);
+	    VM_NEXT();
+	VM_CASE(op_jmp)
+	    VM_JUMP(pc->arg);
+	VM_CASE(op_jpc)
+	    if (*--sp == 0) {
+		VM_JUMP(pc->arg);
+	    }
+	    VM_NEXT();
+	VM_CASE(op_rch)
+	    *sp++ = (short) getchar();
+	    VM_NEXT();
+	VM_CASE(op_wch)
+	    putchar(*--sp);
+	    VM_NEXT();
+	VM_CASE(op_hlt)
+	    goto halted;
+#ifndef VM_THREADED
+	}
+    }
+#endif
+ halted:
+    fflush(stdout);
+    free(code);
+    free(frame);
+    free(stack);
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_JUMP
+}
+
+int main(int argc, char *argv[])
+{
+    const char *cmdname = argv[0];
+    --argc;
+    /* 1 non-option argument */
+    if (argc != 1 || argv[1][0] == '-') {
+	usage(cmdname);
+    }
+    code_seq *cs = code_read_file(argv[1]);
+    unsigned int max_stack = vm_verify(cs);
+    vm_run(cs, max_stack);
+    code_seq_free(cs);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+// Buffered output writers
+#include "writer.h"
+
+// Make w an empty writer for the file out
+void writer_init(writer *w, FILE *out)
+{
+    w->out = out;
+    w->len = 0;
+}
+
+// Write all of the buffered output of w to its file
+void writer_flush(writer *w)
+{
+    if (w->len > 0) {
+	fwrite(w->buf, 1, w->len, w->out);
+	w->len = 0;
+    }
+}
+
+// Spaces to copy from for indentation
+static const char spaces[] = "                                                                ";
+#define NUM_SPACES (sizeof(spaces) - 1)
+
+// Write num spaces to w
+void writer_spaces(writer *w, unsigned int num)
+{
+#ifdef WRITER_STDIO
+    for (unsigned int i = 0; i < num; i++) {
+	fprintf(w->out, " ");
+    }
+#else
+    while (num > NUM_SPACES) {
+	writer_write(w, spaces, NUM_SPACES);
+	num -= NUM_SPACES;
+    }
+    writer_write(w, spaces, num);
+#endif
+}
+
+// Write n to w in decimal
+void writer_int(writer *w, int n)
+{
+#ifdef WRITER_STDIO
+    fprintf(w->out, "%d", n);
+#else
+    // enough for the digits and sign of any int
+    char digits[12];
+    char *p = digits + sizeof(digits);
+    // work with the magnitude as unsigned, so INT_MIN is fine
+    unsigned int mag = n < 0 ? -(unsigned int) n : (unsigned int) n;
+    do {
+	*--p = (char) ('0' + mag % 10);
+	mag /= 10;
+    } while (mag != 0);
+    if (n < 0) {
+	*--p = '-';
+    }
+    writer_write(w, p, digits + sizeof(digits) - p);
+#endif
+}
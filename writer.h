@@ -0,0 +1,75 @@
+#ifndef _WRITER_H
+#define _WRITER_H
+#include <stdio.h>
+#include <string.h>
+
+// Size of a writer's buffer
+#define WRITER_BUFFER_SIZE (64*1024)
+
+// A writer collects output in a large buffer,
+// and only writes it to its file when the buffer fills up
+// (or when it is flushed), so each small piece of output
+// costs a copy instead of a call to stdio.
+typedef struct {
+    FILE *out;
+    size_t len;
+    char buf[WRITER_BUFFER_SIZE];
+} writer;
+
+// Make w an empty writer for the file out
+extern void writer_init(writer *w, FILE *out);
+
+// Write all of the buffered output of w to its file
+extern void writer_flush(writer *w);
+
+#ifdef WRITER_STDIO
+// For comparison (see unparse_bench.c), write each piece of output
+// straight to the file with stdio, as the unparser used to do
+static inline void writer_write(writer *w, const char *s, size_t len)
+{
+    fwrite(s, 1, len, w->out);
+}
+
+static inline void writer_putc(writer *w, char c)
+{
+    putc(c, w->out);
+}
+#else
+// Requires: s has at least len chars
+// Write the first len chars of s to w
+static inline void writer_write(writer *w, const char *s, size_t len)
+{
+    if (len > WRITER_BUFFER_SIZE - w->len) {
+	writer_flush(w);
+	if (len > WRITER_BUFFER_SIZE) {
+	    fwrite(s, 1, len, w->out);
+	    return;
+	}
+    }
+    memcpy(w->buf + w->len, s, len);
+    w->len += len;
+}
+
+// Write the char c to w
+static inline void writer_putc(writer *w, char c)
+{
+    if (w->len == WRITER_BUFFER_SIZE) {
+	writer_flush(w);
+    }
+    w->buf[w->len++] = c;
+}
+#endif
+
+// Write the string s to w
+static inline void writer_puts(writer *w, const char *s)
+{
+    writer_write(w, s, strlen(s));
+}
+
+// Write num spaces to w
+extern void writer_spaces(writer *w, unsigned int num);
+
+// Write n to w in decimal
+extern void writer_int(writer *w, int n);
+
+#endif